@@ -21,6 +21,10 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
   bool _outbound_shutdown { false };
   bool _inbound_shutdown { false };
 
+  // once a stream fills up, only read into it again when half of it has drained, so reads stay large.
+  _outbound.set_watermarks( buffer_size / 2, buffer_size );
+  _inbound.set_watermarks( buffer_size / 2, buffer_size );
+
   socket.set_blocking( false );
   _input.set_blocking( false );
   _output.set_blocking( false );
@@ -31,16 +35,14 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     _input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _outbound.writer().available_capacity() );
-      _input.read( data );
-      _outbound.writer().push( move( data ) );
+      Writer& writer = _outbound.writer();
+      writer.commit( _input.read( writer.reserve( writer.available_capacity() ) ) );
       if ( _input.eof() ) {
         _outbound.writer().close();
       }
     },
     [&] {
-      return !_outbound.has_error() and !_inbound.has_error() and ( _outbound.writer().available_capacity() > 0 )
+      return !_outbound.has_error() and !_inbound.has_error() and _outbound.writer().is_writable()
              and !_outbound.writer().is_closed();
     },
     [&] { _outbound.writer().close(); },
@@ -57,7 +59,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( _outbound.reader().bytes_buffered() ) {
-        _outbound.reader().pop( socket.write( _outbound.reader().peek() ) );
+        _outbound.reader().pop( socket.write( _outbound.reader().peek_regions() ) );
       }
       if ( _outbound.reader().is_finished() ) {
         socket.shutdown( SHUT_WR );
@@ -81,16 +83,14 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _inbound.writer().available_capacity() );
-      socket.read( data );
-      _inbound.writer().push( move( data ) );
+      Writer& writer = _inbound.writer();
+      writer.commit( socket.read( writer.reserve( writer.available_capacity() ) ) );
       if ( socket.eof() ) {
         _inbound.writer().close();
       }
     },
     [&] {
-      return !_inbound.has_error() and !_outbound.has_error() and ( _inbound.writer().available_capacity() > 0 )
+      return !_inbound.has_error() and !_outbound.has_error() and _inbound.writer().is_writable()
              and !_inbound.writer().is_closed();
     },
     [&] { _inbound.writer().close(); },
@@ -107,7 +107,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( _inbound.reader().bytes_buffered() ) {
-        _inbound.reader().pop( _output.write( _inbound.reader().peek() ) );
+        _inbound.reader().pop( _output.write( _inbound.reader().peek_regions() ) );
       }
       if ( _inbound.reader().is_finished() ) {
         _output.close();
@@ -23,6 +23,14 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_chunked)
+ttest(byte_stream_regions)
+ttest(byte_stream_concurrent)
+ttest(byte_stream_reserve)
+ttest(byte_stream_mapped)
+ttest(buffer_pool)
+ttest(byte_stream_splice)
+ttest(byte_stream_watermarks)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -31,12 +39,15 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_storage)
+ttest(reassembler_budget)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
 ttest(wrapping_integers_unwrap)
 ttest(wrapping_integers_roundtrip)
 ttest(wrapping_integers_extra)
+ttest(wrapping_integers_batch)
 
 ttest(recv_connect)
 ttest(recv_transmit)
@@ -45,6 +56,8 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_reassembly_limit)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,6 +66,13 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_sack)
+ttest(send_congestion)
+ttest(send_rto)
+ttest(send_fast_retransmit)
+ttest(send_pacing)
+ttest(send_mss)
+ttest(send_window_scale)
 
 ttest(net_interface)
 
@@ -89,4 +109,8 @@ set_property(TEST ${compile_name_opt} PROPERTY TIMEOUT 0)
 set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
+stest(byte_stream_concurrent_speed_test)
+stest(byte_stream_matrix_speed_test)
 stest(reassembler_speed_test)
+stest(reassembler_workloads_speed_test)
+stest(wrapping_integers_speed_test)
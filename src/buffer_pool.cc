@@ -0,0 +1,106 @@
+#include "buffer_pool.hh"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+BufferPool& BufferPool::local()
+{
+  thread_local BufferPool pool;
+  return pool;
+}
+
+BufferPool::~BufferPool()
+{
+  for ( auto& free_list : _blocks ) {
+    for ( char* block : free_list ) {
+      delete[] block; // NOLINT(*-owning-memory)
+    }
+  }
+}
+
+uint64_t BufferPool::block_size( uint64_t size )
+{
+  return max( SLAB_SIZE, bit_ceil( size ) );
+}
+
+char* BufferPool::allocate( uint64_t size )
+{
+  size = block_size( size );
+  _stats.block_requests++;
+
+  auto& free_list = _blocks[countr_zero( size )];
+  if ( !free_list.empty() ) {
+    char* block = free_list.back();
+    free_list.pop_back();
+    _stats.cached_block_bytes -= size;
+    return block;
+  }
+
+  _stats.block_mallocs++;
+  return new char[size]; // NOLINT(*-owning-memory)
+}
+
+void BufferPool::deallocate( char* block, uint64_t size )
+{
+  size = block_size( size );
+
+  // don't let one thread hoard memory that nobody asks for any more.
+  if ( _stats.cached_block_bytes + size > MAX_CACHED_BYTES ) {
+    delete[] block; // NOLINT(*-owning-memory)
+    return;
+  }
+
+  _blocks[countr_zero( size )].push_back( block );
+  _stats.cached_block_bytes += size;
+}
+
+string BufferPool::_take_cached_string()
+{
+  _stats.string_requests++;
+
+  string str;
+  if ( !_strings.empty() ) {
+    str = move( _strings.back() );
+    _strings.pop_back();
+    _stats.cached_strings--;
+  }
+  return str;
+}
+
+string BufferPool::take_string( size_t capacity )
+{
+  string str = _take_cached_string();
+  str.clear();
+  if ( str.capacity() < capacity ) {
+    _stats.string_mallocs++;
+    str.reserve( capacity );
+  }
+  return str;
+}
+
+string BufferPool::take_buffer( size_t size )
+{
+  string str = _take_cached_string();
+  if ( str.capacity() < size ) {
+    _stats.string_mallocs++;
+  }
+  if ( str.size() < size ) {
+    str.resize( size );
+  }
+  return str;
+}
+
+void BufferPool::recycle( string&& str )
+{
+  // strings that never left the small-string buffer, or that are unusually large, aren't worth keeping.
+  if ( str.capacity() <= string().capacity() || str.capacity() > MAX_STRING_CAPACITY
+       || _strings.size() >= MAX_CACHED_STRINGS ) {
+    return;
+  }
+
+  // (the contents stay, so that take_buffer() need not fill them in again.)
+  _strings.push_back( move( str ) );
+  _stats.cached_strings++;
+}
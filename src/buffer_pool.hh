@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * BufferPool: a per-thread cache of the buffers that connections allocate and free over and over.
+ *
+ * It hands out two kinds of buffers:
+ *   - raw blocks (for ByteStream rings), in power-of-two size classes of at least one slab;
+ *   - strings (for segment payloads, reassembler pieces and stream chunks), reused with their capacity.
+ *
+ * Buffers given back are kept for the next request of the same size instead of being freed, up to a
+ * bound on what each thread keeps around. A buffer may be given back on a different thread than the one
+ * it came from; it then simply joins that thread's pool.
+ *
+ * The counters tell how many requests were served, and how many of them had to go to the system
+ * allocator: once a workload reaches its steady state, the latter should stop growing.
+ */
+class BufferPool
+{
+public:
+  static constexpr uint64_t SLAB_SIZE = 16384;           // smallest raw block handed out
+  static constexpr uint64_t MAX_CACHED_BYTES = 64 << 20; // most raw block bytes kept per thread
+  static constexpr size_t MAX_CACHED_STRINGS = 4096;     // most strings kept per thread
+  static constexpr size_t MAX_STRING_CAPACITY = 65536;   // larger strings are freed, not kept
+
+  struct Stats
+  {
+    uint64_t block_requests {};      // calls to allocate()
+    uint64_t block_mallocs {};       // ...that had to allocate new memory
+    uint64_t string_requests {};     // calls to take_string()
+    uint64_t string_mallocs {};      // ...that had to allocate new memory
+    uint64_t cached_block_bytes {};  // raw block bytes currently kept in the pool
+    uint64_t cached_strings {};      // strings currently kept in the pool
+  };
+
+  // The pool of the calling thread.
+  static BufferPool& local();
+
+  // A block of at least `size` bytes (a power of two, at least SLAB_SIZE). Give it back with deallocate().
+  char* allocate( uint64_t size );
+  void deallocate( char* block, uint64_t size );
+
+  // An empty string with room for at least `capacity` bytes. Give it back with recycle().
+  std::string take_string( size_t capacity );
+
+  // A string of at least `size` bytes, to be written over: the bytes it held before it was given back are left
+  // as they were, and only what it grows by is zero-filled. Give it back with recycle().
+  std::string take_buffer( size_t size );
+  void recycle( std::string&& str );
+
+  const Stats& stats() const { return _stats; }
+
+  BufferPool() = default;
+  ~BufferPool();
+  BufferPool( const BufferPool& other ) = delete;
+  BufferPool& operator=( const BufferPool& other ) = delete;
+  BufferPool( BufferPool&& other ) = delete;
+  BufferPool& operator=( BufferPool&& other ) = delete;
+
+  // The size of the block that allocate( size ) hands out.
+  static uint64_t block_size( uint64_t size );
+
+private:
+  std::array<std::vector<char*>, 64> _blocks {}; // free blocks, indexed by log2 of their size
+  std::vector<std::string> _strings {};          // free strings
+  Stats _stats {};
+
+  // the most recently given back string (or a new one), as it was given back.
+  std::string _take_cached_string();
+};
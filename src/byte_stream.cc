@@ -1,19 +1,123 @@
 #include "byte_stream.hh"
-#include <iostream>
-#include <queue>
+#include "buffer_pool.hh"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity )
+ByteStream::ByteStream( uint64_t capacity, Storage storage )
   : _capacity( capacity )
   , error_( false )
   , _is_closed( false )
-  , _buf()
   , _pushed_bytes( 0 )
   , _buffer_bytes( 0 )
   , _popped_bytes( 0 )
+  , _storage( storage )
+  , _buf()
+  , _chunks()
+  , _reserved()
+  , _low_watermark( capacity > 0 ? capacity - 1 : 0 )
+  , _high_watermark( capacity )
+  , _writable( capacity > 0 )
 {}
 
+void ByteStream::set_watermarks( uint64_t low, uint64_t high )
+{
+  if ( low >= high or high > _capacity ) {
+    throw invalid_argument( "ByteStream: watermarks must satisfy low < high <= capacity" );
+  }
+  _low_watermark = low;
+  _high_watermark = high;
+  _writable = _buffer_bytes < high;
+}
+
+void ByteStream::_after_push( uint64_t buffered_before )
+{
+  if ( _writable and _buffer_bytes >= _high_watermark ) {
+    _writable = false;
+  }
+  if ( buffered_before == 0 and _buffer_bytes > 0 and _on_readable_cb ) {
+    _on_readable_cb();
+  }
+}
+
+void ByteStream::_after_pop()
+{
+  if ( not _writable and _buffer_bytes <= _low_watermark ) {
+    _writable = true;
+    if ( _on_writable_cb ) {
+      _on_writable_cb();
+    }
+  }
+}
+
+void ByteStream::_reserve_ring( uint64_t size )
+{
+  if ( size <= _buf.size() ) {
+    return;
+  }
+
+  if ( _storage == Storage::Mapped ) {
+    const uint64_t ring_size = max( bit_ceil( _capacity ), RingMemory::min_mapped_size() );
+    _buf = RingMemory { ring_size, RingMemory::Kind::MappedFile };
+    return;
+  }
+
+  // grow geometrically from one pool slab, so a stream that is never filled never pays for its whole capacity.
+  uint64_t new_size = max( { _buf.size() * 2, bit_ceil( size ), BufferPool::SLAB_SIZE } );
+  new_size = min( new_size, bit_ceil( _capacity ) );
+
+  RingMemory old_buf { new_size, RingMemory::Kind::Heap };
+  swap( old_buf, _buf );
+
+  // re-home the buffered bytes at their positions under the new mask.
+  const uint64_t old_mask = old_buf.size() - 1;
+  uint64_t index = _popped_bytes;
+  while ( index < _pushed_bytes ) {
+    const uint64_t pos = index & old_mask;
+    const uint64_t len = min( _pushed_bytes - index, old_buf.size() - pos );
+    _copy_in( index, { old_buf.data() + pos, len } );
+    index += len;
+  }
+}
+
+uint64_t ByteStream::_contiguous( uint64_t pos ) const
+{
+  return _buf.mirrored() ? _buf.size() : _buf.size() - pos;
+}
+
+void ByteStream::_copy_in( uint64_t index, string_view data )
+{
+  const uint64_t pos = index & _mask();
+  const uint64_t first = min( static_cast<uint64_t>( data.size() ), _contiguous( pos ) );
+  memcpy( _buf.data() + pos, data.data(), first );
+  memcpy( _buf.data(), data.data() + first, data.size() - first );
+}
+
+void ByteStream::_append( string_view data )
+{
+  if ( data.empty() ) {
+    return;
+  }
+
+  if ( _storage == Storage::Chunked ) {
+    string chunk = BufferPool::local().take_string( data.size() );
+    chunk.assign( data );
+    writer().push( move( chunk ) );
+    return;
+  }
+
+  const uint64_t buffered_before = _buffer_bytes;
+  _reserve_ring( _buffer_bytes + data.size() );
+  _copy_in( _pushed_bytes, data );
+  _buffer_bytes += data.size();
+  _pushed_bytes += data.size();
+  _after_push( buffered_before );
+}
+
 bool Writer::is_closed() const
 {
   return _is_closed;
@@ -21,20 +125,144 @@ bool Writer::is_closed() const
 
 void Writer::push( string data )
 {
-  for ( auto c : data ) {
-    // if no more capacity left, just break and throw the left data.
-    if ( available_capacity() == 0 ) {
+  // if no more capacity left, just throw the left data.
+  const uint64_t len = min( static_cast<uint64_t>( data.size() ), available_capacity() );
+  if ( len == 0 ) {
+    return;
+  }
+
+  if ( _storage == Storage::Chunked ) {
+    // keep only what fits; shrinking the size of a string never moves its bytes.
+    data.resize( len );
+    // but don't let a short string pin a much larger allocation for as long as it is buffered.
+    if ( data.capacity() > 2 * data.size() ) {
+      data.shrink_to_fit();
+    }
+    auto buffer = make_shared<string>( move( data ) );
+    _chunks.push_back( { buffer, *buffer } );
+  } else {
+    _reserve_ring( _buffer_bytes + len );
+    _copy_in( _pushed_bytes, { data.data(), len } );
+    BufferPool::local().recycle( move( data ) );
+  }
+  _buffer_bytes += len;
+  _pushed_bytes += len;
+  _after_push( _buffer_bytes - len );
+}
+
+span<char> Writer::reserve( uint64_t n )
+{
+  n = min( n, available_capacity() );
+
+  // a chunk of its own, that commit() will push without copying.
+  // (the string keeps its size from one reserve() to the next, so its bytes aren't filled in every time.)
+  if ( _storage == Storage::Chunked ) {
+    if ( _reserved.size() < n ) {
+      BufferPool& pool = BufferPool::local();
+      pool.recycle( move( _reserved ) );
+      _reserved = pool.take_buffer( n );
+    }
+    _reserved_length = n;
+    return { _reserved.data(), n };
+  }
+
+  if ( n == 0 ) {
+    return {};
+  }
+  _reserve_ring( _buffer_bytes + n );
+  const uint64_t pos = _pushed_bytes & _mask();
+  return { _buf.data() + pos, min( n, _contiguous( pos ) ) };
+}
+
+void Writer::commit( uint64_t k )
+{
+  if ( _storage == Storage::Chunked ) {
+    _reserved.resize( min( k, _reserved_length ) );
+    _reserved_length = 0;
+    push( exchange( _reserved, {} ) );
+    return;
+  }
+
+  // the bytes are already in place, publishing them is only a matter of counting
+  // (but never count more than the ring can hold).
+  k = min( { k, available_capacity(), _buf.size() - _buffer_bytes } );
+  _buffer_bytes += k;
+  _pushed_bytes += k;
+  if ( k > 0 ) {
+    _after_push( _buffer_bytes - k );
+  }
+}
+
+void Writer::write_at( uint64_t offset, string_view data )
+{
+  if ( _storage == Storage::Chunked ) {
+    throw runtime_error( "ByteStream: write_at() needs Ring or Mapped storage" );
+  }
+  if ( offset >= available_capacity() ) {
+    return;
+  }
+  data = data.substr( 0, available_capacity() - offset );
+
+  // bytes written past the end of the stream aren't re-homed when the ring grows, so it takes its full size first.
+  _reserve_ring( _capacity );
+  _copy_in( _pushed_bytes + offset, data );
+}
+
+void Writer::splice_from( Reader& source, uint64_t len )
+{
+  len = min( { len, source.bytes_buffered(), available_capacity() } );
+  tee_from( source, len );
+  source.pop( len );
+}
+
+void Writer::tee_from( const Reader& source, uint64_t len )
+{
+  const ByteStream& from = source;
+  len = min( { len, source.bytes_buffered(), available_capacity() } );
+
+  // share the source's chunks: the first and last ones may be cut, but their strings stay as they are.
+  if ( _storage == Storage::Chunked && from._storage == Storage::Chunked ) {
+    const uint64_t buffered_before = _buffer_bytes;
+    for ( auto it = from._chunks.begin(); len > 0; ++it ) {
+      const Chunk chunk { it->buffer, it->view.substr( 0, len ) };
+      _chunks.push_back( chunk );
+      _buffer_bytes += chunk.view.size();
+      _pushed_bytes += chunk.view.size();
+      len -= chunk.view.size();
+    }
+    _after_push( buffered_before );
+    return;
+  }
+
+  // otherwise, copy the bytes region by region.
+  for ( auto region : source.peek_regions() ) {
+    region = region.substr( 0, len );
+    _append( region );
+    len -= region.size();
+    if ( len == 0 ) {
       break;
     }
-    _buf.push_back( c );
-    _buffer_bytes++;
-    _pushed_bytes++;
   }
 }
 
 void Writer::close()
 {
+  // an empty stream that gets closed has something new for the Reader: its end.
+  const bool was_readable = reader().is_readable();
   _is_closed = true;
+  if ( not was_readable and _on_readable_cb ) {
+    _on_readable_cb();
+  }
+}
+
+bool Writer::is_writable() const
+{
+  return _writable;
+}
+
+void Writer::on_writable( function<void()> callback )
+{
+  _on_writable_cb = move( callback );
 }
 
 uint64_t Writer::available_capacity() const
@@ -64,18 +292,72 @@ string_view Reader::peek() const
   if ( _buffer_bytes == 0 ) {
     return {};
   }
-  // peek the first char
-  return string_view( &_buf.front(), 1 );
+  // the whole front chunk is contiguous.
+  if ( _storage == Storage::Chunked ) {
+    return _chunks.front().view;
+  }
+  // peek everything up to the end of the ring (if it isn't mirrored), the rest will be seen after popping.
+  const uint64_t pos = _popped_bytes & _mask();
+  return { _buf.data() + pos, min( _buffer_bytes, _contiguous( pos ) ) };
+}
+
+vector<string_view> Reader::peek_regions() const
+{
+  vector<string_view> regions;
+  if ( _buffer_bytes == 0 ) {
+    return regions;
+  }
+
+  if ( _storage == Storage::Chunked ) {
+    regions.reserve( _chunks.size() );
+    for ( const auto& chunk : _chunks ) {
+      regions.push_back( chunk.view );
+    }
+    return regions;
+  }
+
+  // the first region runs up to the wrap point, the second (if any) starts again at the beginning of the ring.
+  regions.push_back( peek() );
+  if ( regions.front().size() < _buffer_bytes ) {
+    regions.emplace_back( _buf.data(), _buffer_bytes - regions.front().size() );
+  }
+  return regions;
 }
 
 void Reader::pop( uint64_t len )
 {
-  while ( len > 0 && _buffer_bytes > 0 ) {
-    _buf.pop_front();
-    _buffer_bytes--;
-    _popped_bytes++;
-    len--;
+  len = min( len, _buffer_bytes );
+  _buffer_bytes -= len;
+  _popped_bytes += len;
+
+  // the ring is emptied by the counters alone, chunks must be released as they are fully popped.
+  if ( _storage == Storage::Chunked ) {
+    while ( len > 0 ) {
+      Chunk& front = _chunks.front();
+      const uint64_t n = min( len, static_cast<uint64_t>( front.view.size() ) );
+      front.view.remove_prefix( n );
+      len -= n;
+      if ( front.view.empty() ) {
+        // the last stream holding a string gives it back to the pool.
+        if ( front.buffer.use_count() == 1 ) {
+          BufferPool::local().recycle( move( *front.buffer ) );
+        }
+        _chunks.pop_front();
+      }
+    }
   }
+
+  _after_pop();
+}
+
+bool Reader::is_readable() const
+{
+  return _buffer_bytes > 0 or _is_closed;
+}
+
+void Reader::on_readable( function<void()> callback )
+{
+  _on_readable_cb = move( callback );
 }
 
 uint64_t Reader::bytes_buffered() const
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "ring_memory.hh"
+
 #include <cstdint>
-#include <queue>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class Reader;
 class Writer;
@@ -11,7 +17,18 @@ class Writer;
 class ByteStream
 {
 public:
-  explicit ByteStream( uint64_t capacity );
+  // How the ByteStream keeps the bytes that have been pushed but not yet popped.
+  enum class Storage
+  {
+    Ring,    // copy pushed bytes into one contiguous ring buffer
+    Chunked, // take ownership of each pushed string, and hand it back out from peek() without copying
+             // (chunks can also be handed over to, or shared with, another Chunked stream: see splice_from)
+    Mapped   // a ring in a memory-mapped temporary file, mapped twice so that peek() never stops at a wrap
+  };
+
+  explicit ByteStream( uint64_t capacity, Storage storage = Storage::Ring );
+
+  Storage storage() const { return _storage; } // How does the stream keep its bytes?
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -22,15 +39,66 @@ public:
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
 
+  /*
+   * Backpressure watermarks, for a Writer that would rather write in large batches: once the stream holds
+   * `high` bytes, the Writer stops being writable (see Writer::is_writable), and only becomes writable
+   * again once the Reader has drained the stream down to `low` bytes. Requires low < high <= capacity.
+   * By default, high is the capacity and low is one byte less (writable whenever there is any room).
+   */
+  void set_watermarks( uint64_t low, uint64_t high );
+
 protected:
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   uint64_t _capacity;
   bool error_ {};
   bool _is_closed;        // determing has the stream been closed
-  std::deque<char> _buf;  // use deque as buffer.
   uint64_t _pushed_bytes; // Writer only: maitain the total number of bytes cumulatively pushed to the stream
   uint64_t _buffer_bytes; // maitain the nummber of bytes currently buffered.
   uint64_t _popped_bytes; // Reader only :maitain the total number of bytes cumulatively popped from stream
+
+  // A pushed string is never modified again, so several chunks (of this and other streams) can share it.
+  struct Chunk
+  {
+    std::shared_ptr<std::string> buffer; // the pushed string
+    std::string_view view;               // the part of `buffer` that is still unread in this stream
+  };
+
+  Storage _storage;             // which of the buffers below holds the bytes
+  RingMemory _buf;              // Ring/Mapped only: ring buffer, its size is always zero or a power of two.
+  std::deque<Chunk> _chunks;    // Chunked only: the unread chunks, in order.
+  std::string _reserved;        // Chunked only: the chunk handed out by reserve(), waiting for commit().
+  uint64_t _reserved_length {}; // ...and how much of it was handed out (the rest is left over from before).
+
+  uint64_t _low_watermark;                  // the Writer becomes writable again at this many buffered bytes
+  uint64_t _high_watermark;                 // ...after it stopped being writable at this many
+  bool _writable;                           // whether the Writer is writable, between the two watermarks
+  std::function<void()> _on_readable_cb {}; // called when the Reader becomes readable
+  std::function<void()> _on_writable_cb {}; // called when the Writer becomes writable again
+
+  friend class Writer; // so that a Writer can take chunks from another stream's Reader
+
+  // Byte `i` of the stream lives at `_buf[i & _mask()]`, so the read and write positions
+  // follow directly from `_popped_bytes` and `_pushed_bytes`.
+  uint64_t _mask() const { return _buf.size() - 1; }
+
+  // Grow the ring (doubling, at most to the capacity rounded up to a power of two)
+  // until it can hold `size` bytes, keeping the buffered bytes in place.
+  // A Mapped ring is only address space until written, so it is created at full size at once.
+  void _reserve_ring( uint64_t size );
+
+  // How many bytes starting at ring position `pos` are contiguous in memory.
+  uint64_t _contiguous( uint64_t pos ) const;
+
+  // Copy `data` into the ring starting at stream index `index`, wrapping if needed.
+  void _copy_in( uint64_t index, std::string_view data );
+
+  // Append a copy of `data` (which must fit in the available capacity), whatever the storage.
+  void _append( std::string_view data );
+
+  // Update the readiness state after bytes were pushed (when `buffered_before` were buffered) or popped,
+  // and run the callback of whichever side just became ready.
+  void _after_push( uint64_t buffered_before );
+  void _after_pop();
 };
 
 class Writer : public ByteStream
@@ -39,6 +107,40 @@ public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
+  /*
+   * Direct writes, without building a string to push:
+   *   `reserve(n)` returns writable space in the stream's own storage for up to `n` bytes (never more than
+   *   the available capacity, and possibly less, e.g. at the wrap point of the ring);
+   *   `commit(k)` then publishes the first `k` bytes written there.
+   * Nothing is visible to the Reader before commit(), and the span is only valid until the next call
+   * to reserve(), commit() or push().
+   */
+  std::span<char> reserve( uint64_t n );
+  void commit( uint64_t k );
+
+  /*
+   * Out-of-order direct writes (Ring and Mapped storage only): `write_at(offset, data)` copies `data` to
+   * where the bytes `offset` bytes past the end of the stream will be (dropping whatever lies beyond the
+   * available capacity), without publishing anything. Once every byte up to some point has been written
+   * this way, `commit(k)` publishes the next `k`. A later push() or reserve() overwrites these bytes.
+   */
+  void write_at( uint64_t offset, std::string_view data );
+
+  /*
+   * Stream-to-stream transfers of up to `len` bytes (never more than `source` has buffered, nor more than
+   * this stream can hold):
+   *   `splice_from` moves them: they are popped from `source` and pushed here;
+   *   `tee_from` shares them: they are pushed here but stay in `source` too.
+   * When both streams are Chunked, no byte is copied: the chunks themselves are handed over (or shared),
+   * at a cost proportional to the number of chunks. With any other storage, the bytes are copied.
+   */
+  void splice_from( Reader& source, uint64_t len );
+  void tee_from( const Reader& source, uint64_t len );
+
+  // Should the Writer push more now (according to the watermarks)? `callback` runs each time it becomes true.
+  bool is_writable() const;
+  void on_writable( std::function<void()> callback );
+
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
@@ -47,8 +149,17 @@ public:
 class Reader : public ByteStream
 {
 public:
-  std::string_view peek() const; // Peek at the next bytes in the buffer
-  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+  std::string_view peek() const; // Peek at the next bytes in the buffer (contiguous, up to the wrap point)
+  void pop( uint64_t len );      // Remove `len` bytes from the buffer, across as many regions as needed
+
+  // Peek at every buffered byte at once, as the in-order list of contiguous regions holding them
+  // (at most two for Ring storage, one for Mapped, one per chunk for Chunked). Suitable for a single writev().
+  std::vector<std::string_view> peek_regions() const;
+
+  // Is there anything for the Reader to do (bytes to pop, or the end of the stream to see)?
+  // `callback` runs each time it becomes true.
+  bool is_readable() const;
+  void on_readable( std::function<void()> callback );
 
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
@@ -0,0 +1,165 @@
+#include "concurrent_byte_stream.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+ConcurrentByteStream::ConcurrentByteStream( uint64_t capacity )
+  : _capacity( capacity )
+  , _buf( bit_ceil( max( capacity, uint64_t { 1 } ) ) )
+  , _pushed_bytes( 0 )
+  , _popped_bytes( 0 )
+  , _is_closed( false )
+  , _error( false )
+  , _readable_event( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_CLOEXEC ) ) )
+  , _writable_event( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_CLOEXEC ) ) )
+{}
+
+void ConcurrentByteStream::_signal( FileDescriptor& event )
+{
+  const uint64_t one = 1;
+  event.write( { reinterpret_cast<const char*>( &one ), sizeof( one ) } ); // NOLINT(*-reinterpret-cast)
+}
+
+void ConcurrentByteStream::_wait( FileDescriptor& event )
+{
+  // reading an eventfd blocks until it has been signalled, then resets it.
+  string counter( sizeof( uint64_t ), 0 );
+  event.read( counter );
+}
+
+void ConcurrentByteStream::set_error()
+{
+  _error = true;
+  _signal( _readable_event );
+  _signal( _writable_event );
+}
+
+// All the accesses to the two counters below are sequentially consistent on purpose: a side that is about
+// to sleep stores its own counter then loads the other's, and the other side does the same in reverse, so
+// at least one of them is guaranteed to see the other's update (and either not sleep, or send a wakeup).
+
+void ConcurrentWriter::push( string data )
+{
+  const uint64_t pushed = _pushed_bytes.load();
+  const uint64_t popped = _popped_bytes.load();
+  const uint64_t len = min( static_cast<uint64_t>( data.size() ), _capacity - ( pushed - popped ) );
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t pos = pushed & _mask();
+  const uint64_t first = min( len, _buf.size() - pos );
+  memcpy( &_buf[pos], data.data(), first );
+  memcpy( _buf.data(), data.data() + first, len - first );
+  _pushed_bytes.store( pushed + len );
+
+  // only a reader that saw an empty buffer can be waiting.
+  if ( _popped_bytes.load() == pushed ) {
+    _signal( _readable_event );
+  }
+}
+
+void ConcurrentWriter::close()
+{
+  _is_closed = true;
+  _signal( _readable_event );
+}
+
+void ConcurrentWriter::wait()
+{
+  while ( available_capacity() == 0 && !has_error() ) {
+    _wait( _writable_event );
+  }
+}
+
+bool ConcurrentWriter::is_closed() const
+{
+  return _is_closed.load();
+}
+
+uint64_t ConcurrentWriter::available_capacity() const
+{
+  return _capacity - ( _pushed_bytes.load() - _popped_bytes.load() );
+}
+
+uint64_t ConcurrentWriter::bytes_pushed() const
+{
+  return _pushed_bytes.load();
+}
+
+string_view ConcurrentReader::peek() const
+{
+  const uint64_t popped = _popped_bytes.load();
+  const uint64_t pos = popped & _mask();
+  return { &_buf[pos], min( _pushed_bytes.load() - popped, _buf.size() - pos ) };
+}
+
+void ConcurrentReader::pop( uint64_t len )
+{
+  const uint64_t popped = _popped_bytes.load();
+  const uint64_t pushed = _pushed_bytes.load();
+  len = min( len, pushed - popped );
+  if ( len == 0 ) {
+    return;
+  }
+  _popped_bytes.store( popped + len );
+
+  // only a writer that saw a full buffer can be waiting.
+  if ( _pushed_bytes.load() - popped == _capacity ) {
+    _signal( _writable_event );
+  }
+}
+
+void ConcurrentReader::wait()
+{
+  while ( bytes_buffered() == 0 && !is_finished() && !has_error() ) {
+    _wait( _readable_event );
+  }
+}
+
+bool ConcurrentReader::is_finished() const
+{
+  // load the flag first: once it is set, every byte the Writer will ever push is already counted.
+  return _is_closed.load() && _pushed_bytes.load() == _popped_bytes.load();
+}
+
+uint64_t ConcurrentReader::bytes_buffered() const
+{
+  return _pushed_bytes.load() - _popped_bytes.load();
+}
+
+uint64_t ConcurrentReader::bytes_popped() const
+{
+  return _popped_bytes.load();
+}
+
+ConcurrentReader& ConcurrentByteStream::reader()
+{
+  static_assert( sizeof( ConcurrentReader ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the Reader." );
+
+  return static_cast<ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentReader& ConcurrentByteStream::reader() const
+{
+  return static_cast<const ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+ConcurrentWriter& ConcurrentByteStream::writer()
+{
+  static_assert( sizeof( ConcurrentWriter ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the Writer." );
+
+  return static_cast<ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentWriter& ConcurrentByteStream::writer() const
+{
+  return static_cast<const ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
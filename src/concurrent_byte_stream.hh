@@ -0,0 +1,76 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ConcurrentReader;
+class ConcurrentWriter;
+
+/*
+ * ConcurrentByteStream: a ByteStream that one thread writes while another thread reads.
+ *
+ * It has the same Reader/Writer interface as ByteStream, but the Writer and the Reader may each be
+ * used from a different thread (one producer, one consumer). The bytes live in a fixed ring buffer,
+ * and the two sides only share the atomic counters of bytes pushed and popped, so neither side ever
+ * takes a lock or makes a system call on the fast path.
+ *
+ * A side that runs out of work can block in wait(): each direction has an eventfd that the other side
+ * signals only when it turns an empty buffer non-empty (or a full buffer non-full), or on close/error.
+ */
+class ConcurrentByteStream
+{
+public:
+  explicit ConcurrentByteStream( uint64_t capacity );
+
+  // Helper functions to access the ConcurrentByteStream's Reader and Writer interfaces
+  ConcurrentReader& reader();
+  const ConcurrentReader& reader() const;
+  ConcurrentWriter& writer();
+  const ConcurrentWriter& writer() const;
+
+  void set_error();                                // Signal that the stream suffered an error.
+  bool has_error() const { return _error.load(); } // Has the stream had an error?
+
+protected:
+  uint64_t _capacity;
+  std::vector<char> _buf;              // ring buffer of bit_ceil(capacity) bytes, never resized.
+  std::atomic<uint64_t> _pushed_bytes; // written only by the Writer
+  std::atomic<uint64_t> _popped_bytes; // written only by the Reader
+  std::atomic<bool> _is_closed;        // written only by the Writer
+  std::atomic<bool> _error;            // may be set by either side
+  FileDescriptor _readable_event;      // eventfd, signalled by the Writer when there is something to read
+  FileDescriptor _writable_event;      // eventfd, signalled by the Reader when there is room to write
+
+  uint64_t _mask() const { return _buf.size() - 1; }
+  static void _signal( FileDescriptor& event ); // wake up the thread waiting on `event`
+  static void _wait( FileDescriptor& event );   // sleep until `event` has been signalled
+};
+
+class ConcurrentWriter : public ConcurrentByteStream
+{
+public:
+  void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+  void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
+  void wait();                   // Block until there is capacity available (or the stream has an error).
+
+  bool is_closed() const;              // Has the stream been closed?
+  uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+};
+
+class ConcurrentReader : public ConcurrentByteStream
+{
+public:
+  std::string_view peek() const; // Peek at the next bytes in the buffer (contiguous, up to the wrap point)
+  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+  void wait();                   // Block until there are bytes to read, or the stream is finished or has an error.
+
+  bool is_finished() const;        // Is the stream finished (closed and fully popped)?
+  uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+};
@@ -0,0 +1,345 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+using namespace std;
+
+namespace {
+
+// The initial window of RFC 5681: 2 to 4 segments, depending on their size.
+uint64_t initial_window( uint64_t mss )
+{
+  return mss > 2190 ? 2 * mss : mss > 1095 ? 3 * mss : 4 * mss;
+}
+
+class NewReno : public CongestionControl
+{
+public:
+  explicit NewReno( uint64_t mss ) : _mss( mss ), _cwnd( initial_window( mss ) ) {}
+
+  uint64_t window() const override { return _cwnd; }
+
+  void on_ack( const Ack& ack ) override
+  {
+    if ( ack.in_recovery ) {
+      return;
+    }
+    // slow start: one MSS more per ACK (at most)...
+    if ( _cwnd < _ssthresh ) {
+      _cwnd += min( ack.acked, _mss );
+      return;
+    }
+    // ...then congestion avoidance: one MSS more per window of data acknowledged (RFC 3465).
+    _acked_in_avoidance += ack.acked;
+    if ( _acked_in_avoidance >= _cwnd ) {
+      _acked_in_avoidance -= _cwnd;
+      _cwnd += _mss;
+    }
+  }
+
+  void on_loss( uint64_t /* now_ms */, uint64_t in_flight ) override
+  {
+    _ssthresh = max( in_flight / 2, 2 * _mss );
+    _cwnd = _ssthresh;
+    _acked_in_avoidance = 0;
+  }
+
+  void on_timeout( uint64_t /* now_ms */, uint64_t in_flight ) override
+  {
+    _ssthresh = max( in_flight / 2, 2 * _mss );
+    _cwnd = _mss;
+    _acked_in_avoidance = 0;
+  }
+
+  void set_mss( uint64_t mss ) override { _mss = mss; }
+
+private:
+  uint64_t _mss;
+  uint64_t _cwnd;
+  uint64_t _ssthresh { UINT64_MAX };
+  uint64_t _acked_in_avoidance {};
+};
+
+// CUBIC keeps its window in segments, as RFC 9438 does.
+class Cubic : public CongestionControl
+{
+public:
+  explicit Cubic( uint64_t mss )
+    : _mss( mss ), _cwnd( static_cast<double>( initial_window( mss ) / mss ) )
+  {}
+
+  uint64_t window() const override { return static_cast<uint64_t>( _cwnd * static_cast<double>( _mss ) ); }
+
+  void on_ack( const Ack& ack ) override
+  {
+    if ( ack.rtt_ms.has_value() ) {
+      _min_rtt_ms = min( _min_rtt_ms.value_or( UINT64_MAX ), ack.rtt_ms.value() );
+    }
+    if ( ack.in_recovery ) {
+      return;
+    }
+    const double acked = static_cast<double>( ack.acked ) / static_cast<double>( _mss );
+
+    if ( _cwnd < _ssthresh ) {
+      _cwnd += min( acked, 1.0 );
+      return;
+    }
+
+    // a congestion avoidance epoch starts at the first ACK after slow start or a loss.
+    if ( not _epoch_start_ms.has_value() ) {
+      _epoch_start_ms = ack.now_ms;
+      _w_est = _cwnd;
+      if ( _cwnd < _w_max ) {
+        _k = cbrt( ( _w_max - _cwnd ) / C );
+      } else {
+        _k = 0;
+        _w_max = _cwnd;
+      }
+    }
+
+    // the cubic window one RTT from now, held between the window now and half again more...
+    const double t = static_cast<double>( ack.now_ms - _epoch_start_ms.value() + _min_rtt_ms.value_or( 0 ) ) / 1000;
+    const double target = clamp( _w_max + C * pow( t - _k, 3 ), _cwnd, 1.5 * _cwnd );
+
+    // ...unless Reno would do better (on short RTTs, it does).
+    _w_est += 3 * ( 1 - BETA ) / ( 1 + BETA ) * acked / _cwnd;
+    _cwnd = _w_est > target ? _w_est : _cwnd + ( target - _cwnd ) * acked / _cwnd;
+  }
+
+  void on_loss( uint64_t /* now_ms */, uint64_t /* in_flight */ ) override
+  {
+    _reduce();
+    _cwnd = _ssthresh;
+  }
+
+  void on_timeout( uint64_t /* now_ms */, uint64_t /* in_flight */ ) override
+  {
+    _reduce();
+    _cwnd = 1;
+  }
+
+  void set_mss( uint64_t mss ) override
+  {
+    // the windows in segments scale so that they stay the same in bytes.
+    const double scale = static_cast<double>( _mss ) / static_cast<double>( mss );
+    _cwnd *= scale;
+    _ssthresh *= scale;
+    _w_max *= scale;
+    _w_est *= scale;
+    _mss = mss;
+  }
+
+private:
+  static constexpr double C = 0.4;
+  static constexpr double BETA = 0.7;
+
+  uint64_t _mss;
+  double _cwnd;
+  double _ssthresh { HUGE_VAL };
+  double _w_max {}; // the window before the last reduction
+  double _k {};     // how long the cubic takes to get back to _w_max, in seconds
+  double _w_est {}; // the window Reno would have
+  std::optional<uint64_t> _epoch_start_ms {};
+  std::optional<uint64_t> _min_rtt_ms {};
+
+  void _reduce()
+  {
+    // when a loss comes before the window got back to where it was, leave room to others (fast convergence).
+    _w_max = _cwnd < _w_max ? _cwnd * ( 1 + BETA ) / 2 : _cwnd;
+    _ssthresh = max( _cwnd * BETA, 2.0 );
+    _epoch_start_ms.reset();
+  }
+};
+
+// A model of the path, from the delivery rate and round-trip time of every ACK: the bottleneck bandwidth
+// is the highest delivery rate of the last few rounds, and the propagation delay is the lowest RTT of the
+// last few seconds. The window is twice their product, once Startup has found the bandwidth.
+class BBR : public CongestionControl
+{
+public:
+  explicit BBR( uint64_t mss ) : _mss( mss ), _cwnd( initial_window( mss ) ) {}
+
+  uint64_t window() const override
+  {
+    return _mode == Mode::ProbeRTT ? min( _cwnd, MIN_WINDOW_SEGMENTS * _mss ) : _cwnd;
+  }
+
+  void on_ack( const Ack& ack ) override
+  {
+    if ( ack.rtt_ms.has_value() ) {
+      _sample( ack );
+    }
+    _update_mode( ack );
+
+    // grow the window by what was acknowledged, up to the target once the model has one.
+    const uint64_t target = _target_window();
+    if ( _filled_pipe ) {
+      _cwnd = min( _cwnd + ack.acked, target );
+    } else if ( _cwnd < target or ack.delivered < initial_window( _mss ) ) {
+      _cwnd += ack.acked;
+    }
+    _cwnd = max( _cwnd, MIN_WINDOW_SEGMENTS * _mss );
+  }
+
+  // A loss doesn't change the model, but no more may be in flight until the next ACK (packet conservation).
+  void on_loss( uint64_t /* now_ms */, uint64_t in_flight ) override
+  {
+    _cwnd = max( in_flight, MIN_WINDOW_SEGMENTS * _mss );
+  }
+
+  void on_timeout( uint64_t /* now_ms */, uint64_t /* in_flight */ ) override { _cwnd = _mss; }
+
+  void set_mss( uint64_t mss ) override { _mss = mss; }
+
+  // The bandwidth, times a gain that depends on the mode (and on the phase of ProbeBW's cycle).
+  std::optional<double> pacing_rate() const override
+  {
+    if ( _bandwidth() == 0 ) {
+      return std::nullopt;
+    }
+    switch ( _mode ) {
+      case Mode::Startup:
+        return HIGH_GAIN * _bandwidth();
+      case Mode::Drain:
+        return _bandwidth() / HIGH_GAIN;
+      case Mode::ProbeBW:
+        return PROBE_BW_GAINS.at( _cycle_index ) * _bandwidth();
+      case Mode::ProbeRTT:
+        break;
+    }
+    return _bandwidth();
+  }
+
+private:
+  static constexpr double HIGH_GAIN = 2.885; // 2 / ln 2: enough to double the delivery rate every round
+  static constexpr double CWND_GAIN = 2;
+  static constexpr size_t BANDWIDTH_ROUNDS = 10;
+  static constexpr uint64_t MIN_RTT_EXPIRY_MS = 10000;
+  static constexpr uint64_t PROBE_RTT_MS = 200;
+  static constexpr uint64_t MIN_WINDOW_SEGMENTS = 4;
+
+  // In ProbeBW, each min RTT paces at the next of these gains: a quarter more to probe for bandwidth, then a
+  // quarter less to drain the queue that made, then cruise.
+  static constexpr std::array<double, 8> PROBE_BW_GAINS { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+
+  enum class Mode
+  {
+    Startup,  // double the window every round, until the delivery rate stops growing
+    Drain,    // let the queue Startup built up drain, pacing slower, with a window of one bandwidth-delay product
+    ProbeBW,  // keep twice the bandwidth-delay product in flight, pacing at about the bandwidth
+    ProbeRTT  // when the lowest RTT is old, hold the window at a few segments for a while to measure it again
+  };
+
+  uint64_t _mss;
+  uint64_t _cwnd;
+  Mode _mode { Mode::Startup };
+
+  // The highest delivery rate (in sequence numbers per millisecond) of each of the last rounds. A round
+  // ends when the messages sent at its start are acknowledged.
+  std::array<double, BANDWIDTH_ROUNDS> _round_bandwidth {};
+  uint64_t _round {};
+  uint64_t _next_round_delivered {};
+  bool _round_start {};
+
+  std::optional<uint64_t> _min_rtt_ms {};
+  uint64_t _min_rtt_stamp_ms {};
+  uint64_t _probe_rtt_done_ms {};
+
+  // Startup is done after three rounds in a row without a quarter more bandwidth.
+  bool _filled_pipe {};
+  double _full_bandwidth {};
+  unsigned _rounds_without_growth {};
+
+  size_t _cycle_index {};
+  uint64_t _cycle_stamp_ms {};
+
+  double _bandwidth() const { return *max_element( _round_bandwidth.begin(), _round_bandwidth.end() ); }
+
+  uint64_t _bdp() const
+  {
+    return static_cast<uint64_t>( _bandwidth() * static_cast<double>( _min_rtt_ms.value_or( 0 ) ) );
+  }
+
+  uint64_t _target_window() const
+  {
+    if ( not _min_rtt_ms.has_value() or _bandwidth() == 0 ) {
+      return UINT64_MAX;
+    }
+    const double gain = _mode == Mode::Startup ? HIGH_GAIN : _mode == Mode::Drain ? 1 : CWND_GAIN;
+    return max( static_cast<uint64_t>( gain * static_cast<double>( _bdp() ) ), MIN_WINDOW_SEGMENTS * _mss );
+  }
+
+  void _sample( const Ack& ack )
+  {
+    const uint64_t rtt = ack.rtt_ms.value();
+
+    _round_start = ack.delivered_at_send >= _next_round_delivered;
+    if ( _round_start ) {
+      _round++;
+      _next_round_delivered = ack.delivered;
+      _round_bandwidth.at( _round % BANDWIDTH_ROUNDS ) = 0;
+    }
+    const double rate
+      = static_cast<double>( ack.delivered - ack.delivered_at_send ) / static_cast<double>( max( rtt, 1UL ) );
+    auto& bandwidth = _round_bandwidth.at( _round % BANDWIDTH_ROUNDS );
+    bandwidth = max( bandwidth, rate );
+
+    if ( not _min_rtt_ms.has_value() or rtt <= _min_rtt_ms.value() ) {
+      _min_rtt_ms = rtt;
+      _min_rtt_stamp_ms = ack.now_ms;
+    }
+  }
+
+  void _update_mode( const Ack& ack )
+  {
+    if ( _mode == Mode::Startup and _round_start ) {
+      if ( _bandwidth() >= _full_bandwidth * 1.25 ) {
+        _full_bandwidth = _bandwidth();
+        _rounds_without_growth = 0;
+      } else if ( ++_rounds_without_growth >= 3 ) {
+        _filled_pipe = true;
+        _mode = Mode::Drain;
+      }
+    }
+    if ( _mode == Mode::Drain and ack.in_flight <= _bdp() ) {
+      _mode = Mode::ProbeBW;
+      _cycle_index = 2; // start cruising (probing right after Drain would only rebuild the queue)
+      _cycle_stamp_ms = ack.now_ms;
+    } else if ( _mode == Mode::ProbeBW and ack.now_ms - _cycle_stamp_ms > _min_rtt_ms.value_or( 0 ) ) {
+      _cycle_index = ( _cycle_index + 1 ) % PROBE_BW_GAINS.size();
+      _cycle_stamp_ms = ack.now_ms;
+    }
+
+    if ( _mode != Mode::ProbeRTT and _min_rtt_ms.has_value()
+         and ack.now_ms - _min_rtt_stamp_ms > MIN_RTT_EXPIRY_MS ) {
+      _mode = Mode::ProbeRTT;
+      _probe_rtt_done_ms = ack.now_ms + max( PROBE_RTT_MS, _min_rtt_ms.value() );
+      _min_rtt_ms.reset();
+    } else if ( _mode == Mode::ProbeRTT and ack.now_ms >= _probe_rtt_done_ms ) {
+      _mode = _filled_pipe ? Mode::ProbeBW : Mode::Startup;
+    }
+  }
+};
+
+} // namespace
+
+unique_ptr<CongestionControl> CongestionControl::make( Algorithm algorithm, uint64_t mss )
+{
+  switch ( algorithm ) {
+    case Algorithm::None:
+      return nullptr;
+    case Algorithm::NewReno:
+      return make_unique<NewReno>( mss );
+    case Algorithm::Cubic:
+      return make_unique<Cubic>( mss );
+    case Algorithm::BBR:
+      return make_unique<BBR>( mss );
+  }
+  return nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+// A congestion controller: it decides how many sequence numbers the TCPSender may have in flight (the
+// congestion window), from what the sender tells it about ACKs, losses and timeouts.
+class CongestionControl
+{
+public:
+  enum class Algorithm
+  {
+    None,    // no congestion window: the sender fills the receiver's window
+    NewReno, // slow start, then one MSS more per RTT, and half the window on a loss (RFC 5681, RFC 6582)
+    Cubic,   // a window that grows as a cubic function of the time since the last loss (RFC 9438)
+    BBR      // a window of twice the estimated bandwidth-delay product, ignoring isolated losses (BBRv1)
+  };
+
+  // A new congestion controller of the given kind (or nullptr, for None), for segments of `mss` bytes.
+  static std::unique_ptr<CongestionControl> make( Algorithm algorithm, uint64_t mss );
+
+  // What the sender knows when an ACK acknowledges new data.
+  struct Ack
+  {
+    uint64_t now_ms {};                // the sender's clock
+    uint64_t acked {};                 // how many sequence numbers were newly acknowledged
+    uint64_t in_flight {};             // how many are still outstanding, after these
+    uint64_t delivered {};             // how many have been acknowledged in all, these included
+    uint64_t delivered_at_send {};     // `delivered` when the newest message acknowledged was sent
+    std::optional<uint64_t> rtt_ms {}; // how long ago that message was sent, if it was sent only once (Karn)
+    bool in_recovery {};               // the sender is repairing a loss, and the window isn't to grow yet
+  };
+
+  virtual ~CongestionControl() = default;
+
+  // How many sequence numbers may be in flight?
+  virtual uint64_t window() const = 0;
+
+  virtual void on_ack( const Ack& ack ) = 0;
+
+  // A message was taken as lost (because messages sent after it arrived). The sender calls this once per
+  // window of data, not once per message lost.
+  virtual void on_loss( uint64_t now_ms, uint64_t in_flight ) = 0;
+
+  // The retransmission timer expired.
+  virtual void on_timeout( uint64_t now_ms, uint64_t in_flight ) = 0;
+
+  // The sender's segments are now `mss` bytes (path MTU discovery found that larger ones get through). The
+  // window stays the same number of bytes; it's what it grows and shrinks by that changes.
+  virtual void set_mss( uint64_t mss ) = 0;
+
+  // The rate to pace messages out at, in sequence numbers per millisecond, if the controller has its own
+  // (or else, a pacing sender goes by the window and the RTT).
+  virtual std::optional<double> pacing_rate() const { return std::nullopt; }
+};
@@ -1,104 +1,414 @@
 #include "reassembler.hh"
+#include "buffer_pool.hh"
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <ratio>
 #include <stdexcept>
+#include <string_view>
 #include <utility>
 
 using namespace std;
 
+namespace {
+
+// The `len` bytes of `data` starting at `offset`. Cutting the tail is free, but cutting the head means
+// copying the rest into a pooled string.
+string cut( string data, uint64_t offset, uint64_t len )
+{
+  if ( offset == 0 ) {
+    data.resize( len );
+    return data;
+  }
+  string piece = BufferPool::local().take_string( len );
+  piece.assign( data, offset, len );
+  BufferPool::local().recycle( move( data ) );
+  return piece;
+}
+
+} // namespace
+
+Reassembler::Totals Reassembler::_global {};
+
 Reassembler::Reassembler( ByteStream&& output )
-  : _output( std::move( output ) ), _next_expected_index( 0 ), _buffer(), _end_index( UINT64_MAX )
+  : _output( std::move( output ) )
+  , _next_expected_index( 0 )
+  , _buffer()
+  , _end_index( UINT64_MAX )
+  , _runs()
+  , _mutex()
+  , _reach( 0 )
+  , _pending_bytes()
+  , _memory_limit( UINT64_MAX )
+  , _bytes_evicted( 0 )
+  , _recent()
+  , _in_place( _output.storage() != ByteStream::Storage::Chunked )
+{
+  const lock_guard registry( _global.registry_mutex );
+  _global.registry.insert( this );
+}
+
+// (holding the registry's mutex, no other thread can be evicting from `other`.)
+Reassembler::Reassembler( Reassembler&& other )
+  : Reassembler( std::move( other ), unique_lock( _global.registry_mutex ) )
 {}
 
+Reassembler::Reassembler( Reassembler&& other, unique_lock<mutex> /* registry_lock */ )
+  : _output( std::move( other._output ) )
+  , _next_expected_index( other._next_expected_index )
+  , _buffer( std::move( other._buffer ) )
+  , _end_index( other._end_index )
+  , _runs( std::move( other._runs ) )
+  , _mutex()
+  , _reach( other._reach.exchange( 0 ) )
+  , _pending_bytes( std::move( other._pending_bytes ) )
+  , _memory_limit( other._memory_limit )
+  , _bytes_evicted( other._bytes_evicted )
+  , _recent( std::move( other._recent ) )
+  , _in_place( other._in_place )
+{
+  other._runs.clear();
+  other._buffer.clear();
+  _global.registry.insert( this );
+}
+
+Reassembler::~Reassembler()
+{
+  const lock_guard registry( _global.registry_mutex );
+  _global.registry.erase( this );
+}
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
 {
-  // !!! do not use std::map, it is slow for multipul insert and erase operations.
+  {
+    const lock_guard stored( _mutex );
+    _store( first_index, move( data ), is_last_substring );
+    _flush();
+  }
+  if ( _global.pending > _global.limit ) {
+    _evict_globally();
+  }
+}
+
+void Reassembler::insert_batch( span<Segment> segments )
+{
+  // in order of index, each segment mostly extends the one before it, and in-order ones go straight through.
+  if ( not ranges::is_sorted( segments, {}, &Segment::first_index ) ) {
+    ranges::stable_sort( segments, {}, &Segment::first_index );
+  }
+  {
+    const lock_guard stored( _mutex );
+    for ( auto& segment : segments ) {
+      _store( segment.first_index, move( segment.data ), segment.is_last_substring );
+    }
+    _flush();
+  }
+  if ( _global.pending > _global.limit ) {
+    _evict_globally();
+  }
+}
+
+uint64_t Reassembler::bytes_pending() const
+{
+  const lock_guard stored( _mutex );
+  return _pending_bytes.value();
+}
+
+uint64_t Reassembler::bytes_evicted() const
+{
+  const lock_guard stored( _mutex );
+  return _bytes_evicted;
+}
 
+uint64_t Reassembler::hole_count() const
+{
+  const lock_guard stored( _mutex );
+  return _runs.size();
+}
+
+uint64_t Reassembler::buffered_end_index() const
+{
+  const lock_guard stored( _mutex );
+  return _runs.empty() ? _next_expected_index : _runs.rbegin()->second;
+}
+
+void Reassembler::_store( uint64_t first_index, string data, bool is_last_substring )
+{
   // if this is the last substring, update _end_index
   if ( is_last_substring ) {
     _end_index = first_index + data.size();
   }
 
-  // if current index is less than _next_need_index, skip it.
-  uint64_t start_index = max( first_index, _next_expected_index );
-  // if current index is out of range, break the loop
-  uint64_t end_index = min( writer().available_capacity() + _next_expected_index, first_index + data.size() ) - 1;
-  // if the valid range is empty, no need to insert
-  if ( end_index < start_index || data.empty() )
-    goto close_check;
+  // keep only the bytes in [start, end): not written yet, and within the available capacity.
+  const uint64_t start = max( first_index, _next_expected_index );
+  const uint64_t end = min( writer().available_capacity() + _next_expected_index, first_index + data.size() );
+  if ( start >= end ) {
+    return;
+  }
 
-  // ** first, insert all data into buffer with mergy **
-  {
-    data = data.substr( start_index - first_index, end_index - start_index + 1 );
-    piceData curr_data = { start_index, end_index, move( data ) };
-    // if find a subData.end_index < curr_data.start, means no need to merge and continue.
-    // so use binary search to find the first subData that its end_index >= curr_data.start_index.
-    auto it = lower_bound( _buffer.begin(), _buffer.end(), curr_data, []( const piceData& a, const piceData& b ) {
-      return a.end_index < b.start_index;
-    } );
-    // loop all inside buffer_data to compress the buffer by merge
-    while ( it != _buffer.end() ) {
-      // if find a subData that is overlaped by curr_data, just remove it and continue the loop
-      if ( it->start_index >= curr_data.start_index && it->end_index <= curr_data.end_index ) {
-        it = _buffer.erase( it );
-        continue;
-      }
+  // in-order bytes, with nothing waiting after them: a plain push.
+  if ( start == _next_expected_index and _runs.empty() ) {
+    _output.writer().push( cut( move( data ), start - first_index, end - start ) );
+    _next_expected_index = end;
+    return;
+  }
+
+  // remember where out-of-order bytes went, for the SACK blocks.
+  if ( start > _next_expected_index ) {
+    if ( _recent.size() == RECENT_INSERTS ) {
+      _recent.pop_back();
+    }
+    _recent.insert( _recent.begin(), start );
+  }
+
+  // (in place, the budgets may leave room for only some of the bytes.)
+  uint64_t kept_end = end;
+  if ( _in_place ) {
+    kept_end = _store_in_place( first_index, move( data ), start, end );
+  } else {
+    _store_pieces( first_index, move( data ), start, end );
+  }
+  if ( kept_end > start ) {
+    _add_run( start, kept_end );
+  }
+}
 
-      // if find a subData that overlaps curr_data. no need to do anything.
-      if ( it->start_index <= curr_data.start_index && it->end_index >= curr_data.end_index ) {
-        goto close_check;
+void Reassembler::_flush()
+{
+  // write out the run that starts where the stream ends, if any: its pieces, or its bytes in the ring.
+  if ( not _runs.empty() and _runs.begin()->first == _next_expected_index ) {
+    const uint64_t ready = _runs.begin()->second;
+    _runs.erase( _runs.begin() );
+    _pending_bytes -= ready - _next_expected_index;
+    if ( _in_place ) {
+      _output.writer().commit( ready - _next_expected_index );
+    } else {
+      for ( auto piece = _buffer.begin(); piece != _buffer.end() and piece->first < ready; ) {
+        _output.writer().push( move( piece->second ) );
+        piece = _buffer.erase( piece );
       }
+    }
+    _next_expected_index = ready;
+  }
+
+  // stay within this Reassembler's budget (in place, nothing past it was taken in: see _store_in_place).
+  if ( _pending_bytes.value() > _memory_limit ) {
+    _evict( _pending_bytes.value() - _memory_limit );
+  }
+  _publish_reach();
+
+  // check if all bytes have been written to the output stream
+  if ( _next_expected_index == _end_index ) {
+    _output.writer().close();
+  }
+}
+
+vector<pair<uint64_t, uint64_t>> Reassembler::sack_ranges( size_t max_ranges ) const
+{
+  const lock_guard stored( _mutex );
+  vector<pair<uint64_t, uint64_t>> ranges;
+  const auto add = [&]( const pair<uint64_t, uint64_t>& run ) {
+    if ( ranges.size() < max_ranges and find( ranges.begin(), ranges.end(), run ) == ranges.end() ) {
+      ranges.push_back( run );
+    }
+  };
+
+  // the runs that hold the latest inserts (unless those bytes were written out since)...
+  for ( const uint64_t index : _recent ) {
+    auto run = _runs.upper_bound( index );
+    if ( run != _runs.begin() and prev( run )->second > index ) {
+      add( *prev( run ) );
+    }
+  }
+
+  // ...then the others, lowest first.
+  for ( const auto& run : _runs ) {
+    add( run );
+  }
+  return ranges;
+}
+
+void Reassembler::_store_pieces( uint64_t first_index, string data, uint64_t start, uint64_t end )
+{
+  auto it = _buffer.lower_bound( start );
+
+  // the piece that starts before this one either covers all of it (then there is nothing new here),
+  // or overlaps its beginning (then the older piece gives up its tail: shrinking a string is free).
+  if ( it != _buffer.begin() ) {
+    auto& [before_index, before] = *prev( it );
+    const uint64_t before_end = before_index + before.size();
+    if ( before_end >= end ) {
+      return;
+    }
+    if ( before_end > start ) {
+      before.resize( start - before_index );
+      _pending_bytes -= before_end - start;
+    }
+  }
+
+  // the pieces that start inside this one are covered by it, except maybe the last one, which may
+  // run past its end (then this one gives up its tail instead).
+  while ( it != _buffer.end() and it->first < end ) {
+    if ( it->first + it->second.size() > end ) {
+      end = it->first;
+      break;
+    }
+    _pending_bytes -= it->second.size();
+    BufferPool::local().recycle( move( it->second ) );
+    it = _buffer.erase( it );
+  }
+
+  // the bytes wait for the gap before them (if there is one still: see _flush).
+  if ( start < end ) {
+    _buffer.emplace_hint( it, start, cut( move( data ), start - first_index, end - start ) );
+    _pending_bytes += end - start;
+  }
+}
+
+uint64_t Reassembler::_store_in_place( uint64_t first_index, string data, uint64_t start, uint64_t end )
+{
+  Writer& writer = _output.writer();
 
-      // if find a subData.start_index > curr_data.end_index, break the loop
-      if ( it->start_index > curr_data.end_index ) {
-        break;
+  // out of order, only as many new bytes as the budgets have room for are taken: the rest are refused.
+  uint64_t room = UINT64_MAX;
+  if ( start > _next_expected_index ) {
+    const uint64_t global_pending = _global.pending;
+    const uint64_t global_limit = _global.limit;
+    room = min( _memory_limit - min( _memory_limit, _pending_bytes.value() ),
+                global_limit - min( global_limit, global_pending ) );
+  }
+
+  // copy the bytes that aren't in the ring yet, gap by gap between the runs (the ones that are stay as
+  // they were), until there is no room left. The bytes taken run from `start` to `kept_end`.
+  auto run = _runs.upper_bound( start );
+  if ( run != _runs.begin() and prev( run )->second > start ) {
+    --run;
+  }
+  uint64_t kept_end = end;
+  uint64_t refused = 0;
+  for ( uint64_t gap = start; gap < end; ++run ) {
+    const uint64_t gap_end = run == _runs.end() ? end : min( end, run->first );
+    if ( gap < gap_end ) {
+      const uint64_t taken = min( room, gap_end - gap );
+      if ( taken > 0 ) {
+        writer.write_at( gap - _next_expected_index, string_view( data ).substr( gap - first_index, taken ) );
+        _pending_bytes += taken;
+        room -= taken;
+      }
+      if ( taken < gap_end - gap ) {
+        kept_end = min( kept_end, gap + taken );
+        refused += gap_end - gap - taken;
       }
+    }
+    if ( run == _runs.end() ) {
+      break;
+    }
+    gap = max( gap, run->second );
+  }
+
+  // (refused bytes count as evicted: the sender will send them again all the same.)
+  _bytes_evicted += refused;
+  _global.evicted += refused;
 
-      // left is two cases:
-      // case1: subData.end_index < curr_data.end_index, merge subData to curr_data's left
-      if ( it->end_index < curr_data.end_index ) {
-        string add_data = it->data.substr( 0, curr_data.start_index - it->start_index );
-        curr_data.start_index = it->start_index;
-        curr_data.data.insert( 0, move( add_data ) );
+  BufferPool::local().recycle( move( data ) );
+  return kept_end;
+}
+
+void Reassembler::_evict( uint64_t bytes )
+{
+  while ( bytes > 0 and not _runs.empty() ) {
+    // the tail of the last run, or all of it...
+    const auto last = prev( _runs.end() );
+    const uint64_t from = last->second - min( bytes, last->second - last->first );
+
+    // ...and the pieces holding it (in place, the bytes can stay in the ring as they are).
+    while ( not _in_place and not _buffer.empty() ) {
+      const auto piece = prev( _buffer.end() );
+      if ( piece->first >= from ) {
+        BufferPool::local().recycle( move( piece->second ) );
+        _buffer.erase( piece );
+        continue;
       }
-      // case2: subData.start_index <= curr_data.end_index, merge subData to curr_data's right
-      else {
-        string add_data
-          = it->data.substr( curr_data.end_index - it->start_index + 1, it->end_index - curr_data.end_index );
-        curr_data.end_index = it->end_index;
-        curr_data.data.append( move( add_data ) );
+      if ( piece->first + piece->second.size() > from ) {
+        piece->second.resize( from - piece->first );
       }
-      // remove the subData from buffer
-      it = _buffer.erase( it );
+      break;
     }
-    // insert curr_data into buffer
-    _buffer.emplace( it, move( curr_data ) );
-
-    // ** then, write valid data from buffer to output stream **
-    it = _buffer.begin();
-    while ( it != _buffer.end() && it->start_index == _next_expected_index ) {
-      _output.writer().push( move( it->data ) );
-      _next_expected_index = it->end_index + 1;
-      it = _buffer.erase( it );
+
+    const uint64_t evicted = last->second - from;
+    _pending_bytes -= evicted;
+    _bytes_evicted += evicted;
+    _global.evicted += evicted;
+    bytes -= evicted;
+    if ( from == last->first ) {
+      _runs.erase( last );
+    } else {
+      last->second = from;
     }
   }
+  _publish_reach();
+}
 
-// check if all bytes have been written to the output stream
-close_check:
-  if ( _next_expected_index == _end_index ) {
-    _output.writer().close();
+void Reassembler::_evict_globally()
+{
+  const lock_guard registry( _global.registry_mutex );
+  while ( _global.pending > _global.limit ) {
+    // the Reassembler whose bytes go furthest ahead of its stream, and how far the next one's go.
+    Reassembler* victim = nullptr;
+    uint64_t furthest = 0;
+    uint64_t next_furthest = 0;
+    for ( Reassembler* reassembler : _global.registry ) {
+      const uint64_t reach = reassembler->_reach.load( memory_order_relaxed );
+      if ( reach > furthest ) {
+        next_furthest = furthest;
+        furthest = reach;
+        victim = reassembler;
+      } else {
+        next_furthest = max( next_furthest, reach );
+      }
+    }
+    if ( victim == nullptr ) {
+      return;
+    }
+
+    // its bytes past the next one's go first (or, if they go as far, its whole last run).
+    const lock_guard stored( victim->_mutex );
+    if ( victim->_runs.empty() ) {
+      victim->_publish_reach();
+      continue;
+    }
+    const auto& [first, last] = *victim->_runs.rbegin();
+    const uint64_t past = last - max( first, min( last, victim->_next_expected_index + next_furthest ) );
+    const uint64_t global_pending = _global.pending;
+    victim->_evict( min( global_pending - min<uint64_t>( global_pending, _global.limit ),
+                         past > 0 ? past : last - first ) );
   }
 }
 
-uint64_t Reassembler::bytes_pending() const
+void Reassembler::_publish_reach()
 {
-  // return the total size in buffer
-  uint64_t total_size = 0;
-  for ( const auto& subData : _buffer ) {
-    total_size += subData.data.size();
+  // (a hint only, checked again under the victim's mutex: no ordering is needed.)
+  _reach.store( _in_place or _runs.empty() ? 0 : _runs.rbegin()->second - _next_expected_index,
+                memory_order_relaxed );
+}
+
+void Reassembler::_add_run( uint64_t start, uint64_t end )
+{
+  // extend the run that reaches `start`, or start a new one...
+  auto next = _runs.upper_bound( start );
+  auto run = next;
+  if ( next != _runs.begin() and prev( next )->second >= start ) {
+    run = prev( next );
+    run->second = max( run->second, end );
+  } else {
+    run = _runs.emplace_hint( next, start, end );
+  }
+
+  // ...and swallow the runs that start inside it.
+  while ( next != _runs.end() and next->first <= run->second ) {
+    run->second = max( run->second, next->second );
+    next = _runs.erase( next );
   }
-  return total_size;
 }
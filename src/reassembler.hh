@@ -1,19 +1,32 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <queue>
+#include <span>
+#include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 class Reassembler
 {
 public:
   // Construct Reassembler to write into given ByteStream.
+  // With a Chunked stream, bytes that can't be written yet are kept as the strings they arrived in, and
+  // handed over to the stream when the gap before them closes. With a Ring or Mapped stream, they are
+  // written straight to their final place in the stream's ring instead (see Writer::write_at).
   explicit Reassembler( ByteStream&& output );
+  Reassembler( Reassembler&& other );
+  ~Reassembler();
+  Reassembler( const Reassembler& other ) = delete;
+  Reassembler& operator=( const Reassembler& other ) = delete;
+  Reassembler& operator=( Reassembler&& other ) = delete;
 
   /*
    * Insert a new substring to be reassembled into a ByteStream.
@@ -37,9 +50,50 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring );
 
+  // A substring, as insert() takes it.
+  struct Segment
+  {
+    uint64_t first_index;
+    std::string data;
+    bool is_last_substring;
+  };
+
+  // Insert many substrings at once, as if one by one, but sorted by index first (the span is reordered,
+  // and the strings moved from), and with the stored bytes written out to the stream once, at the end.
+  void insert_batch( std::span<Segment> segments );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 
+  // Memory budgets for the stored bytes: one for this Reassembler, and one for all the Reassemblers of the
+  // process together (unlimited by default).
+  // Over a Chunked stream, an insert that leaves either one exceeded evicts stored bytes, the furthest ahead
+  // of their stream first: this Reassembler's for its own budget, and those of every Reassembler (on any
+  // thread) for the global one. The sender will send evicted bytes again, like bytes that were lost.
+  // Over a Ring or Mapped stream, the bytes are in the ring already, and evicting them would free nothing:
+  // out-of-order bytes past either budget are refused instead (bytes that continue the stream never are).
+  void set_memory_limit( uint64_t bytes ) { _memory_limit = bytes; }
+  static void set_global_memory_limit( uint64_t bytes ) { _global.limit = bytes; }
+
+  // How many stored bytes were evicted (or refused) to stay within the budgets, from this Reassembler and
+  // from all of them?
+  uint64_t bytes_evicted() const;
+  static uint64_t global_bytes_evicted() { return _global.evicted; }
+
+  // How many bytes are stored in all the Reassemblers together?
+  static uint64_t global_bytes_pending() { return _global.pending; }
+
+  // How many gaps are there in front of the stored bytes (the one before the first stored byte included)?
+  uint64_t hole_count() const;
+
+  // The highest index stored, plus one (or the index of the next byte to be written, if nothing is stored).
+  uint64_t buffered_end_index() const;
+
+  // Up to `max_ranges` runs of stored bytes, as [first index, last index + 1), for the receiver to report
+  // as SACK blocks (RFC 2018): the run holding the most recently stored bytes first, then the runs of the
+  // inserts before it, then the others in order.
+  std::vector<std::pair<uint64_t, uint64_t>> sack_ranges( size_t max_ranges ) const;
+
   // Access output stream reader
   Reader& reader() { return _output.reader(); }
   const Reader& reader() const { return _output.reader(); }
@@ -55,12 +109,96 @@ public:
 private:
   ByteStream _output;            // the Reassembler writes to this ByteStream.
   uint64_t _next_expected_index; // the index of the next byte to be written.
-  struct piceData
+
+  // The bytes that can't be written yet, as disjoint pieces keyed by the index of their first byte.
+  // Pieces are never merged: each one keeps the string it arrived in (trimmed where it overlaps its
+  // neighbours), so inserting one costs O(log n) plus the pieces it covers, and no byte is ever moved.
+  std::map<uint64_t, std::string> _buffer;
+  uint64_t _end_index; // use for determine the end.
+
+  // The stored bytes as maximal runs [start, end), keyed by start (each one has a gap in front of it).
+  // In place (Ring and Mapped streams), the bytes themselves are already in the ring, and the runs are
+  // all there is to know about which ones.
+  std::map<uint64_t, uint64_t> _runs;
+
+  // The totals of every Reassembler, and every Reassembler itself, for the global budget to evict from.
+  // They may be on different threads: the registry has a mutex, and so do each one's stored bytes (always
+  // taken after the registry's, if both are).
+  struct Totals
   {
-    uint64_t start_index;
-    uint64_t end_index;
-    std::string data;
+    std::atomic<uint64_t> pending { 0 };
+    std::atomic<uint64_t> evicted { 0 };
+    std::atomic<uint64_t> limit { UINT64_MAX };
+    std::mutex registry_mutex {};
+    std::unordered_set<Reassembler*> registry {};
   };
-  std::deque<piceData> _buffer; // use for store bytes that can't be written yet.
-  uint64_t _end_index;          // use for determine the end.
+  static Totals _global;
+
+  mutable std::mutex _mutex;       // guards the stored bytes, which another thread may evict
+  std::atomic<uint64_t> _reach {}; // how far past the next expected index they go (Chunked only, else 0)
+
+  Reassembler( Reassembler&& other, std::unique_lock<std::mutex> registry_lock );
+
+  // A count of stored bytes that keeps the total of every Reassembler up to date.
+  class PendingBytes
+  {
+  public:
+    PendingBytes() = default;
+    PendingBytes( const PendingBytes& other ) : _bytes( other._bytes ) { _global.pending += _bytes; }
+    PendingBytes( PendingBytes&& other ) noexcept : _bytes( std::exchange( other._bytes, 0 ) ) {}
+    PendingBytes& operator=( const PendingBytes& other ) { return *this = PendingBytes( other ); }
+    PendingBytes& operator=( PendingBytes&& other ) noexcept
+    {
+      std::swap( _bytes, other._bytes );
+      return *this;
+    }
+    ~PendingBytes() { _global.pending -= _bytes; }
+
+    uint64_t value() const { return _bytes; }
+    PendingBytes& operator+=( uint64_t n )
+    {
+      _bytes += n;
+      _global.pending += n;
+      return *this;
+    }
+    PendingBytes& operator-=( uint64_t n )
+    {
+      _bytes -= n;
+      _global.pending -= n;
+      return *this;
+    }
+
+  private:
+    uint64_t _bytes {};
+  };
+
+  PendingBytes _pending_bytes; // bytes stored, kept up to date by every insert
+  uint64_t _memory_limit;
+  uint64_t _bytes_evicted;
+
+  // The first stored index of the latest out-of-order inserts, newest first (for sack_ranges).
+  static constexpr size_t RECENT_INSERTS = 8;
+  std::vector<uint64_t> _recent;
+
+  bool _in_place;
+
+  // Keep the new bytes of a substring (or push them, if they are next and nothing else is waiting), and
+  // write out the run of kept bytes that starts where the stream ends, if any.
+  void _store( uint64_t first_index, std::string data, bool is_last_substring );
+  void _flush();
+  void _store_pieces( uint64_t first_index, std::string data, uint64_t start, uint64_t end );
+  uint64_t _store_in_place( uint64_t first_index, std::string data, uint64_t start, uint64_t end );
+
+  // Drop up to `bytes` of the stored bytes, the highest indices first.
+  void _evict( uint64_t bytes );
+
+  // Evict from every Reassembler, the bytes furthest ahead of their streams first, until the global budget
+  // is met again (or only bytes in rings are left).
+  static void _evict_globally();
+
+  // Update _reach, once the stored bytes changed.
+  void _publish_reach();
+
+  // Add [start, end) to the runs, merging it with every run it overlaps or touches.
+  void _add_run( uint64_t start, uint64_t end );
 };
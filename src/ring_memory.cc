@@ -0,0 +1,119 @@
+#include "ring_memory.hh"
+#include "buffer_pool.hh"
+#include "exception.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// Map a fresh, already-unlinked temporary file of `size` bytes twice in a row, and return the address.
+char* map_mirrored_file( uint64_t size )
+{
+  const char* tmpdir = getenv( "TMPDIR" ); // NOLINT(*-mt-unsafe)
+  string path = string( tmpdir ? tmpdir : "/tmp" ) + "/minnow_ring.XXXXXX";
+  const int fd = CheckSystemCall( "mkstemp", mkstemp( path.data() ) );
+  unlink( path.c_str() ); // the mappings keep the file alive.
+
+  // grab 2 * size bytes of address space, then map the file over each half.
+  void* base = mmap( nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  void* first = MAP_FAILED;
+  void* second = MAP_FAILED;
+  if ( ftruncate( fd, static_cast<off_t>( size ) ) == 0 and base != MAP_FAILED ) {
+    char* const half = static_cast<char*>( base ) + size;
+    first = mmap( base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 );
+    second = mmap( half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 );
+  }
+  const int saved_errno = errno;
+  close( fd );
+
+  if ( first == MAP_FAILED or second == MAP_FAILED ) {
+    if ( base != MAP_FAILED ) {
+      munmap( base, 2 * size );
+    }
+    throw unix_error { "mmap mirrored ring", saved_errno };
+  }
+
+  return static_cast<char*>( base );
+}
+
+} // namespace
+
+uint64_t RingMemory::min_mapped_size()
+{
+  return static_cast<uint64_t>( sysconf( _SC_PAGESIZE ) );
+}
+
+RingMemory::RingMemory( uint64_t size, Kind kind ) : _kind( kind ), _data( nullptr ), _size( size )
+{
+  if ( size == 0 ) {
+    return;
+  }
+
+  if ( kind == Kind::MappedFile ) {
+    if ( size % min_mapped_size() ) {
+      throw runtime_error( "RingMemory: a mapped ring must be a whole number of pages" );
+    }
+    _data = map_mirrored_file( size );
+  } else {
+    _data = BufferPool::local().allocate( size );
+  }
+}
+
+void RingMemory::_release()
+{
+  if ( _data == nullptr ) {
+    return;
+  }
+
+  if ( _kind == Kind::MappedFile ) {
+    munmap( _data, 2 * _size );
+  } else {
+    BufferPool::local().deallocate( _data, _size );
+  }
+  _data = nullptr;
+  _size = 0;
+}
+
+RingMemory::~RingMemory()
+{
+  _release();
+}
+
+RingMemory::RingMemory( const RingMemory& other ) : RingMemory( other._size, other._kind )
+{
+  if ( _size ) {
+    memcpy( _data, other._data, _size );
+  }
+}
+
+RingMemory& RingMemory::operator=( const RingMemory& other )
+{
+  if ( this != &other ) {
+    RingMemory copy { other };
+    *this = move( copy );
+  }
+  return *this;
+}
+
+RingMemory::RingMemory( RingMemory&& other ) noexcept
+  : _kind( other._kind ), _data( exchange( other._data, nullptr ) ), _size( exchange( other._size, 0 ) )
+{}
+
+RingMemory& RingMemory::operator=( RingMemory&& other ) noexcept
+{
+  if ( this != &other ) {
+    _release();
+    _kind = other._kind;
+    _data = exchange( other._data, nullptr );
+    _size = exchange( other._size, 0 );
+  }
+  return *this;
+}
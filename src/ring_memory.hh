@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * RingMemory: the memory behind a ByteStream's ring buffer.
+ *
+ * It owns `size()` bytes at `data()`, where the size is zero or a power of two. The bytes come either
+ * from the heap (through the thread's BufferPool, so connections that come and go reuse each other's
+ * rings), or from a temporary file mapped into memory (so rings much larger than what the heap should
+ * hold are backed by the page cache instead).
+ *
+ * A mapped ring is mapped twice, back to back, so that `data()[size() + i]` is the same byte as
+ * `data()[i]`: any run of up to `size()` bytes starting anywhere in the ring is contiguous in memory,
+ * even when it wraps around. `mirrored()` tells whether that is the case.
+ *
+ * Copying a RingMemory copies the bytes into new memory of the same kind.
+ */
+class RingMemory
+{
+public:
+  enum class Kind
+  {
+    Heap,
+    MappedFile
+  };
+
+  RingMemory() = default;
+  RingMemory( uint64_t size, Kind kind );
+  ~RingMemory();
+
+  RingMemory( const RingMemory& other );
+  RingMemory& operator=( const RingMemory& other );
+  RingMemory( RingMemory&& other ) noexcept;
+  RingMemory& operator=( RingMemory&& other ) noexcept;
+
+  char* data() { return _data; }
+  const char* data() const { return _data; }
+  uint64_t size() const { return _size; }
+  bool mirrored() const { return _kind == Kind::MappedFile; }
+
+  // The smallest ring a MappedFile can hold (one page, since the mapping works page by page).
+  static uint64_t min_mapped_size();
+
+private:
+  Kind _kind { Kind::Heap };
+  char* _data { nullptr };
+  uint64_t _size { 0 };
+
+  void _release();
+};
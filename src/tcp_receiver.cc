@@ -1,9 +1,11 @@
 #include "tcp_receiver.hh"
 #include "byte_stream.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "wrapping_integers.hh"
 #include <cstdint>
 #include <optional>
+#include <utility>
 
 using namespace std;
 
@@ -26,12 +28,17 @@ void TCPReceiver::receive( TCPSenderMessage message )
   // only if we've recived SYN, process the data
   if ( SYN ) {
     uint64_t checkpoint = writer().bytes_pushed();
-    uint64_t first_index = message.seqno.unwrap( _zero_point, checkpoint ) - 1; // not include SYN
     // byte with invalid stream index should be ignored, which means the message.seqno == _zero_point.
     if ( message.seqno == _zero_point ) {
       return;
     }
-    _reassembler.insert( first_index, message.payload, message.FIN );
+    // a message that ends at or before the ackno has nothing new (nor does an empty one at the ackno).
+    const Wrap32 ackno = Wrap32::wrap( checkpoint + 1 + writer().is_closed(), _zero_point );
+    if ( message.seqno + static_cast<uint32_t>( message.sequence_length() ) <= ackno ) {
+      return;
+    }
+    uint64_t first_index = message.seqno.unwrap( _zero_point, checkpoint ) - 1; // not include SYN
+    _reassembler.insert( first_index, move( message.payload ), message.FIN );
   }
 }
 
@@ -48,7 +55,15 @@ TCPReceiverMessage TCPReceiver::send() const
       ackno = ackno.value() + 1;
     }
   }
-  uint16_t window_size = writer().available_capacity() > UINT16_MAX ? UINT16_MAX : writer().available_capacity();
+  const uint64_t window = writer().available_capacity() >> _window_shift;
+  uint16_t window_size = window > UINT16_MAX ? UINT16_MAX : window;
   // use constructor to create a TCPReceiverMessage
-  return { ackno, window_size, has_error() };
+  TCPReceiverMessage msg { ackno, window_size, has_error() };
+  // report the bytes held past the ackno as SACK blocks (their stream indices are seqnos - 1, for the SYN)
+  if ( SYN ) {
+    for ( const auto& [first, last] : _reassembler.sack_ranges( TCPConfig::MAX_SACK_BLOCKS ) ) {
+      msg.sack.emplace_back( Wrap32::wrap( first + 1, _zero_point ), Wrap32::wrap( last + 1, _zero_point ) );
+    }
+  }
+  return msg;
 }
@@ -25,6 +25,10 @@ public:
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
   TCPReceiverMessage send() const;
 
+  // Send windows in units of 2^shift sequence numbers (RFC 7323), once both ends have sent the window scale
+  // option.
+  void set_window_scale( uint8_t shift ) { _window_shift = shift; }
+
   // Access the output (only Reader is accessible non-const)
   const Reassembler& reassembler() const { return _reassembler; }
   Reader& reader() { return _reassembler.reader(); }
@@ -38,7 +42,8 @@ public:
 
 private:
   Reassembler _reassembler;
-  Wrap32 _zero_point; // use for unwrap
-  bool SYN;           // if set, means we've received a SYN from the peer
-  bool RYN;           // if set, means error happend.
+  Wrap32 _zero_point;       // use for unwrap
+  bool SYN;                 // if set, means we've received a SYN from the peer
+  bool RYN;                 // if set, means error happend.
+  uint8_t _window_shift {}; // the window sent is the available capacity >> this (rounded down)
 };
@@ -1,13 +1,21 @@
 #include "tcp_sender.hh"
+#include "buffer_pool.hh"
 #include "byte_stream.hh"
 #include "tcp_config.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <iterator>
+#include <optional>
+#include <vector>
 
 using namespace std;
 
+// Path MTU discovery stops once the MSS is this close to the largest size not ruled out.
+static constexpr uint64_t MIN_PROBE_STEP = 32;
+
 uint64_t TCPSender::sequence_numbers_in_flight() const
 {
   return _outstanding_sequence_numbers;
@@ -18,10 +26,76 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return _consecutive_retransmissions_times;
 }
 
+uint64_t TCPSender::congestion_window() const
+{
+  return _congestion_control ? _congestion_control->window() : UINT64_MAX;
+}
+
+optional<uint64_t> TCPSender::smoothed_RTT_ms() const
+{
+  if ( not _smoothed_RTT_us.has_value() ) {
+    return nullopt;
+  }
+  return _smoothed_RTT_us.value() / 1000;
+}
+
+optional<double> TCPSender::pacing_rate() const
+{
+  if ( _congestion_control and _congestion_control->pacing_rate().has_value() ) {
+    return _congestion_control->pacing_rate();
+  }
+  if ( not _smoothed_RTT_us.has_value() ) {
+    return nullopt;
+  }
+  const uint64_t window = min<uint64_t>( _window_size, congestion_window() );
+  const uint64_t smoothed_RTT_us = max<uint64_t>( _smoothed_RTT_us.value(), 1 );
+  return 2 * static_cast<double>( window ) * 1000 / static_cast<double>( smoothed_RTT_us );
+}
+
+void TCPSender::set_adaptive_RTO( uint64_t min_ms, uint64_t max_ms )
+{
+  _adaptive_RTO = true;
+  _RTO_min_ms = min_ms;
+  _RTO_max_ms = max_ms;
+}
+
+void TCPSender::set_MSS( uint64_t MSS )
+{
+  _MSS_ceiling = MSS;
+  _change_MSS( MSS );
+}
+
+void TCPSender::set_path_MTU_discovery( uint64_t max_MSS )
+{
+  _MTU_discovery = true;
+  _MSS_ceiling = max_MSS;
+  _change_MSS( min( _MSS, max_MSS ) );
+}
+
 void TCPSender::push( const TransmitFunction& transmit )
 {
-  // while still can send messages
-  while ( _outstanding_sequence_numbers < _window_size ) {
+  // first send again the messages that the SACK blocks showed were lost, once each
+  for ( auto& outstanding : _outstanding_segments_collection ) {
+    if ( outstanding.lost ) {
+      transmit( outstanding.msg );
+      outstanding.lost = false;
+      outstanding.resent = true;
+      outstanding.retransmitted = true;
+    }
+  }
+
+  // the receiver's window, and the congestion window if there is one (inflated during fast recovery)
+  const uint64_t window = min<uint64_t>(
+    _window_size, _congestion_control ? _congestion_control->window() + _recovery_inflation : UINT64_MAX );
+
+  // while still can send messages (and, when pacing, it's time for the next one)
+  _paced_back = false;
+  while ( _outstanding_sequence_numbers < window ) {
+    if ( _pacing and _now_ms * 1000 < _next_send_us ) {
+      _paced_back = true;
+      break;
+    }
+
     TCPSenderMessage msg;
     // if have not send SYN
     if ( !_has_send_SYN ) {
@@ -32,15 +106,25 @@ void TCPSender::push( const TransmitFunction& transmit )
     // set the sequence number with current _checkpoint
     msg.seqno = Wrap32::wrap( _abs_seq, isn_ );
 
-    // get the biggest len of payload, which is the minimun of (TCPConfig::MAX_PACKET_SIZE, _window_size -
+    // with path MTU discovery, one message at a time may be a probe, larger than the MSS: when there's data
+    // and window enough for all of it, and no loss is being repaired.
+    const bool probe = not msg.SYN and _probe_size > 0 and not _probe_in_flight and not _in_recovery
+                       and reader().bytes_buffered() >= _probe_size
+                       and window - _outstanding_sequence_numbers >= _probe_size;
+    _probe_in_flight |= probe;
+
+    // get the biggest len of payload, which is the minimun of (the MSS or the probe size, window -
     // _outstanding_sequece_number, ByteSteam)
-    size_t payload_len = min( TCPConfig::MAX_PAYLOAD_SIZE,
-                              min( _window_size - _outstanding_sequence_numbers, reader().bytes_buffered() ) );
+    size_t payload_len = min( probe ? _probe_size : _MSS,
+                              min( window - _outstanding_sequence_numbers, reader().bytes_buffered() ) );
+    if ( payload_len > 0 ) {
+      msg.payload = BufferPool::local().take_string( payload_len );
+    }
     read( input_.reader(), payload_len, msg.payload );
     _outstanding_sequence_numbers += payload_len;
 
     // if have read all the bytes in reader, check if have send FIN and it is availible to send it
-    if ( reader().is_finished() && !_has_send_FIN && _outstanding_sequence_numbers < _window_size ) {
+    if ( reader().is_finished() && !_has_send_FIN && _outstanding_sequence_numbers < window ) {
       msg.FIN = true;
       _has_send_FIN = true;
       _outstanding_sequence_numbers++;
@@ -65,8 +149,15 @@ void TCPSender::push( const TransmitFunction& transmit )
     // use transmit to send
     transmit( msg );
 
+    // when pacing, the next message may go once this one has gone out at the pacing rate.
+    if ( _pacing and pacing_rate().has_value() ) {
+      const double gap_us = static_cast<double>( msg.sequence_length() ) * 1000 / pacing_rate().value();
+      _next_send_us = max( _next_send_us, _previous_tick_us ) + static_cast<uint64_t>( gap_us );
+    }
+
     // add msg to the outstanding_segments_collection
-    _outstanding_segments_collection.push_back( std::move( msg ) );
+    _outstanding_segments_collection.push_back(
+      { .msg = std::move( msg ), .sent_at_ms = _now_ms, .delivered_at_send = _delivered, .probe = probe } );
   }
 }
 
@@ -81,8 +172,10 @@ TCPSenderMessage TCPSender::make_empty_message() const
 
 void TCPSender::receive( const TCPReceiverMessage& msg )
 {
-  // set the window size, if the msg.window_size == 0, set to 1.
-  _receiver_window_size = msg.window_size;
+  // set the window size (scaled, unless it's on the receiver's SYN), if the msg.window_size == 0, set to 1.
+  const uint64_t previous_window_size = _receiver_window_size;
+  const uint8_t shift = msg.window_scale.has_value() ? 0 : _window_shift;
+  _receiver_window_size = static_cast<uint64_t>( msg.window_size ) << shift;
   _window_size = _receiver_window_size == 0 ? 1 : _receiver_window_size;
 
   // check RST
@@ -90,32 +183,119 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
     set_error();
   }
 
+  // the receiver's MSS option caps the messages, and the probes.
+  if ( msg.MSS.has_value() and msg.MSS.value() > 0 and msg.MSS.value() < _MSS_ceiling ) {
+    _MSS_ceiling = msg.MSS.value();
+    _change_MSS( min<uint64_t>( _MSS, _MSS_ceiling ) );
+  }
+
   // When the receiver gives the sender an ackno that acknowledges the successful receipt
   // of new data (the ackno reflects an absolute sequence number bigger than any previous
   // ackno):
   if ( msg.ackno.has_value() ) {
-    uint64_t abs_seq_ackno = msg.ackno.value().unwrap( isn_, _abs_seq );
+    const Wrap32 ackno = msg.ackno.value();
+    const Wrap32 next_seqno = Wrap32::wrap( _abs_seq, isn_ );
+    // if Impossible ackno (beyond next seqno, or before the ISN), ignore.
+    if ( ackno > next_seqno or static_cast<uint32_t>( next_seqno - ackno ) > _abs_seq ) {
+      return;
+    }
+    const uint64_t abs_seq_ackno = _abs_seq - static_cast<uint32_t>( next_seqno - ackno );
+
+    // a duplicate ACK still tells what the receiver holds past the ackno...
+    bool lost = _mark_sacked( msg.sack );
+
+    // ...and, with congestion control, that one more message after the ackno has arrived (RFC 5681): after
+    // DUP_THRESH of them, the message at the ackno is taken as lost and sent again (fast retransmit), and each
+    // one lets one more message out while the window is reduced (fast recovery).
+    const bool duplicate = _congestion_control and abs_seq_ackno == _pre_ack_ackno
+                           and !_outstanding_segments_collection.empty()
+                           and _receiver_window_size == previous_window_size;
+    bool fast_retransmit = false;
+    if ( duplicate ) {
+      _duplicate_acks++;
+      if ( _in_recovery ) {
+        _recovery_inflation += _MSS;
+      } else if ( _duplicate_acks >= TCPConfig::DUP_THRESH ) {
+        Outstanding& front = _outstanding_segments_collection.front();
+        lost |= not front.resent and not front.lost and not front.probe;
+        front.lost |= not front.resent;
+        fast_retransmit = true;
+      }
+    }
+    _split_lost_probe();
+
+    // losses reduce the congestion window once, until the data sent by then is acknowledged.
+    if ( lost and _congestion_control and abs_seq_ackno >= _recovery_point ) {
+      _congestion_control->on_loss( _now_ms, _outstanding_sequence_numbers );
+      _recovery_point = _abs_seq;
+      _in_recovery = true;
+    }
+
+    // (the window is only inflated in recovery: after a timeout, the losses were already reacted to.)
+    if ( fast_retransmit and _in_recovery ) {
+      _recovery_inflation = _duplicate_acks * _MSS;
+    }
+
     // if not ack a new data, just ignore so it won't reset the timer.
-    // if Impossible ackno (beyond next seqno), also ignore.
-    if ( abs_seq_ackno <= _pre_ack_ackno || abs_seq_ackno > _abs_seq ) {
+    if ( abs_seq_ackno <= _pre_ack_ackno ) {
       return;
     }
 
+    // (the SYN carries no data, so acknowledging it tells nothing about congestion.)
+    const uint64_t acked = abs_seq_ackno - _pre_ack_ackno - ( _pre_ack_ackno == 0 );
     _pre_ack_ackno = abs_seq_ackno;
+    _delivered += acked;
+    CongestionControl::Ack ack {
+      .now_ms = _now_ms, .acked = acked, .delivered = _delivered, .in_recovery = _in_recovery };
 
     // remove segment in outstanding collections that all the sequence number <= _edge_left.
+    // (all of them are within one window of the ackno, so comparing seqnos is enough.)
     for ( auto it = _outstanding_segments_collection.begin(); it != _outstanding_segments_collection.end(); ) {
-      auto& sequence = *it;
-      if ( sequence.seqno.unwrap( isn_, _abs_seq ) + sequence.sequence_length() <= abs_seq_ackno ) {
+      auto& sequence = it->msg;
+      if ( sequence.seqno + static_cast<uint32_t>( sequence.sequence_length() ) <= ackno ) {
+        ack.delivered_at_send = it->delivered_at_send;
+        ack.rtt_ms = it->retransmitted ? nullopt : optional<uint64_t> { _now_ms - it->sent_at_ms };
+        if ( it->probe ) {
+          _probe_acked( *it );
+        }
         _outstanding_sequence_numbers -= sequence.sequence_length();
+        BufferPool::local().recycle( move( sequence.payload ) );
         it = _outstanding_segments_collection.erase( it );
       } else {
         break;
       }
     }
 
-    // Set the RTO back to its “initial value.”
-    _RTO = initial_RTO_ms_;
+    _duplicate_acks = 0;
+    if ( not _in_recovery or abs_seq_ackno >= _recovery_point ) {
+      // a full ACK (or a new one outside recovery): the window is the congestion controller's, uninflated.
+      _in_recovery = false;
+      _recovery_inflation = 0;
+    } else if ( _in_recovery ) {
+      // a partial ACK: the message at the new ackno was lost too, so send it now (RFC 6582), and take back
+      // the inflation the acknowledged messages were standing for.
+      Outstanding& front = _outstanding_segments_collection.front();
+      front.lost |= not front.resent and not front.sacked;
+      const uint64_t inflation = _recovery_inflation + _MSS;
+      _recovery_inflation = inflation - min( acked, inflation );
+      _split_lost_probe();
+    }
+
+    if ( _congestion_control ) {
+      ack.in_flight = _outstanding_sequence_numbers;
+      _congestion_control->on_ack( ack );
+    }
+    if ( ack.rtt_ms.has_value() ) {
+      _sample_RTT( ack.rtt_ms.value() );
+    }
+
+    // Set the RTO back to its “initial value” (or, when it's adaptive, to what the estimates give, if there
+    // is a new sample).
+    if ( not _adaptive_RTO ) {
+      _RTO = initial_RTO_ms_;
+    } else if ( ack.rtt_ms.has_value() ) {
+      _RTO = _estimated_RTO();
+    }
     _retransmission_timer = timer( _RTO );
     // If the sender has any outstanding data, restart the retransmission timer so that it will expire after RTO
     // milliseconds
@@ -129,6 +309,9 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 
 void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
 {
+  _previous_tick_us = _now_ms * 1000;
+  _now_ms += ms_since_last_tick;
+
   // if current has a timer running
   if ( _retransmission_timer.isRunning() ) {
     // reduce its RTO by ms_since_last_tick
@@ -136,17 +319,179 @@ void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& trans
 
     // if RTO has expired
     if ( _retransmission_timer.RTO() <= 0 ) {
-      // need  Retransmit the earliest (lowest sequence number) segment that hasn’t been fully acknowledged
-      transmit( _outstanding_segments_collection.front() );
+      // need  Retransmit the earliest (lowest sequence number) segment that hasn’t been fully acknowledged.
+      // (the receiver may have dropped what it SACKed, so after a timeout the SACKs count for nothing: RFC 2018.)
+      for ( auto& outstanding : _outstanding_segments_collection ) {
+        outstanding.sacked = false;
+      }
+      auto earliest = _outstanding_segments_collection.begin();
+      // (a probe goes again in messages of the MSS: the first one now, and the others at the next push.)
+      if ( earliest->probe ) {
+        earliest->lost = true;
+        earliest = _split_lost_probe();
+        // (with no lost probe found after all, the front message goes as it is.)
+        if ( earliest == _outstanding_segments_collection.end() ) {
+          earliest = _outstanding_segments_collection.begin();
+        }
+        earliest->lost = false;
+      }
+      transmit( earliest->msg );
+      earliest->retransmitted = true;
       // If the window size is nonzero:
       if ( _receiver_window_size > 0 ) {
+        // it's taken as congestion.
+        if ( _congestion_control ) {
+          _congestion_control->on_timeout( _now_ms, _outstanding_sequence_numbers );
+          _recovery_point = _abs_seq;
+          _in_recovery = false;
+          _recovery_inflation = 0;
+          _duplicate_acks = 0;
+        }
         // increase consecutive retransmissions times
         _consecutive_retransmissions_times++;
         // Double the value of RTO.
-        _RTO *= 2;
+        _RTO = min( _RTO * 2, _RTO_max_ms );
       }
       // reset timer.
       _retransmission_timer.reset( _RTO );
     }
   }
+
+  // send the messages that pacing held back, if their time has come.
+  if ( _paced_back ) {
+    push( transmit );
+  }
+}
+
+bool TCPSender::_mark_sacked( const vector<pair<Wrap32, Wrap32>>& sack )
+{
+  if ( sack.empty() ) {
+    return false;
+  }
+
+  // the messages are in order, so the ones in a block are found by binary search.
+  for ( const auto& [left, right] : sack ) {
+    auto it = partition_point(
+      _outstanding_segments_collection.begin(),
+      _outstanding_segments_collection.end(),
+      [&]( const Outstanding& outstanding ) { return outstanding.msg.seqno < left; } );
+    for ( ; it != _outstanding_segments_collection.end(); ++it ) {
+      if ( it->msg.seqno + static_cast<uint32_t>( it->msg.sequence_length() ) > right ) {
+        break;
+      }
+      if ( it->probe ) {
+        _probe_acked( *it );
+      }
+      it->sacked = true;
+    }
+  }
+
+  // a message with DUP_THRESH SACKed messages after it is taken as lost (RFC 6675).
+  bool newly_lost = false;
+  unsigned sacked_after = 0;
+  for ( auto it = _outstanding_segments_collection.rbegin(); it != _outstanding_segments_collection.rend(); ++it ) {
+    if ( it->sacked ) {
+      sacked_after++;
+    } else if ( sacked_after >= TCPConfig::DUP_THRESH and not it->resent ) {
+      // (a lost probe may just have been too large for the path, which is no sign of congestion.)
+      newly_lost |= not it->lost and not it->probe;
+      it->lost = true;
+    }
+  }
+  return newly_lost;
+}
+
+void TCPSender::_sample_RTT( uint64_t RTT_ms )
+{
+  const uint64_t sample = RTT_ms * 1000;
+  if ( not _smoothed_RTT_us.has_value() ) {
+    _smoothed_RTT_us = sample;
+    _RTT_variation_us = sample / 2;
+    return;
+  }
+  const uint64_t smoothed = _smoothed_RTT_us.value();
+  // RTTVAR <- 3/4 RTTVAR + 1/4 |SRTT - R|, then SRTT <- 7/8 SRTT + 1/8 R.
+  _RTT_variation_us = ( 3 * _RTT_variation_us + max( smoothed, sample ) - min( smoothed, sample ) ) / 4;
+  _smoothed_RTT_us = ( 7 * smoothed + sample ) / 8;
+}
+
+uint64_t TCPSender::_estimated_RTO() const
+{
+  // RTO <- SRTT + max(G, 4 RTTVAR), where the clock granularity G is the millisecond of tick(), rounded up.
+  const uint64_t RTO_us = _smoothed_RTT_us.value_or( 0 ) + max<uint64_t>( 1000, 4 * _RTT_variation_us );
+  return clamp( ( RTO_us + 999 ) / 1000, _RTO_min_ms, _RTO_max_ms );
+}
+
+void TCPSender::_change_MSS( uint64_t MSS )
+{
+  if ( MSS != _MSS and _congestion_control ) {
+    // before any data is acknowledged, the controller starts over, with the initial window of the new MSS.
+    if ( _delivered == 0 ) {
+      _congestion_control = CongestionControl::make( _congestion_algorithm, MSS );
+    } else {
+      _congestion_control->set_mss( MSS );
+    }
+  }
+  _MSS = MSS;
+  _next_probe();
+}
+
+void TCPSender::_next_probe()
+{
+  // a binary search between the MSS, which the path takes, and the largest size not ruled out yet.
+  const uint64_t gap = _MSS_ceiling - _MSS;
+  _probe_size = _MTU_discovery and gap >= MIN_PROBE_STEP ? _MSS + ( gap + 1 ) / 2 : 0;
+}
+
+void TCPSender::_probe_acked( Outstanding& probe )
+{
+  probe.probe = false;
+  _probe_in_flight = false;
+  _probe_failures = 0;
+  _change_MSS( max<uint64_t>( _MSS, min<uint64_t>( probe.msg.payload.size(), _MSS_ceiling ) ) );
+}
+
+deque<TCPSender::Outstanding>::iterator TCPSender::_split_lost_probe()
+{
+  // (without a probe in flight, there's nothing to look for: most senders never probe.)
+  if ( not _probe_in_flight ) {
+    return _outstanding_segments_collection.end();
+  }
+
+  const auto probe
+    = find_if( _outstanding_segments_collection.begin(),
+               _outstanding_segments_collection.end(),
+               []( const Outstanding& outstanding ) { return outstanding.probe and outstanding.lost; } );
+  if ( probe == _outstanding_segments_collection.end() ) {
+    return probe;
+  }
+
+  // after MAX_PROBES losses, the path is taken not to carry messages that size.
+  _probe_in_flight = false;
+  if ( ++_probe_failures >= TCPConfig::MAX_PROBES ) {
+    _probe_failures = 0;
+    _MSS_ceiling = min<uint64_t>( _MSS_ceiling, probe->msg.payload.size() - 1 );
+    _next_probe();
+  }
+
+  // the data goes again in messages of the MSS, the FIN (if any) with the last one.
+  const TCPSenderMessage& msg = probe->msg;
+  vector<Outstanding> pieces;
+  for ( size_t offset = 0; offset < msg.payload.size(); offset += _MSS ) {
+    TCPSenderMessage piece;
+    piece.seqno = msg.seqno + static_cast<uint32_t>( offset );
+    piece.payload = msg.payload.substr( offset, _MSS );
+    piece.RST = msg.RST;
+    pieces.push_back( { .msg = std::move( piece ),
+                        .lost = true,
+                        .retransmitted = true,
+                        .sent_at_ms = probe->sent_at_ms,
+                        .delivered_at_send = probe->delivered_at_send } );
+  }
+  pieces.back().msg.FIN = msg.FIN;
+
+  BufferPool::local().recycle( move( probe->msg.payload ) );
+  const auto at = _outstanding_segments_collection.erase( probe );
+  return _outstanding_segments_collection.insert(
+    at, make_move_iterator( pieces.begin() ), make_move_iterator( pieces.end() ) );
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
@@ -11,6 +13,8 @@
 #include <memory>
 #include <optional>
 #include <queue>
+#include <utility>
+#include <vector>
 
 class timer
 {
@@ -44,8 +48,11 @@ private:
 class TCPSender
 {
 public:
-  /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
+  /* Construct TCP sender with given default Retransmission Timeout, possible ISN and congestion control */
+  TCPSender( ByteStream&& input,
+             Wrap32 isn,
+             uint64_t initial_RTO_ms,
+             CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::None )
     : input_( std::move( input ) )
     , isn_( isn )
     , _abs_seq( 0 )
@@ -60,6 +67,8 @@ public:
     , _has_send_SYN( false )
     , _has_send_FIN( false )
     , _pre_ack_ackno( 0 )
+    , _congestion_algorithm( congestion_control )
+    , _congestion_control( CongestionControl::make( congestion_control, TCPConfig::MAX_PAYLOAD_SIZE ) )
   {}
 
   /* Generate an empty TCPSenderMessage */
@@ -80,6 +89,50 @@ public:
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  uint64_t congestion_window() const;           // How many may be in flight, as far as congestion goes?
+
+  // RTT estimates (RFC 6298), from the ACKs of messages that were sent only once (Karn's rule), and the RTO
+  std::optional<uint64_t> smoothed_RTT_ms() const;
+  uint64_t RTT_variation_ms() const { return _RTT_variation_us / 1000; }
+  uint64_t current_RTO_ms() const { return _RTO; }
+
+  /*
+   * Let the RTO follow the RTT estimates, held between `min_ms` and `max_ms` (backoff included), instead of
+   * going back to the initial RTO at every new ACK. The initial RTO holds until the first RTT sample, and
+   * after a backoff, the RTO stays backed off until an ACK gives a new one.
+   */
+  void set_adaptive_RTO( uint64_t min_ms, uint64_t max_ms );
+
+  /*
+   * Spread new messages out over time instead of sending them back to back: at the congestion controller's
+   * pacing rate if it has one, or else at twice the window per smoothed RTT (no pacing before the first RTT
+   * sample). push() holds back the messages whose time hasn't come, and tick() sends them when it does.
+   * The clock is tick()'s, so a message's time may come up to one tick late (and then the ones after it
+   * catch up).
+   */
+  void set_pacing( bool enabled ) { _pacing = enabled; }
+  std::optional<double> pacing_rate() const; // in sequence numbers per millisecond
+
+  /*
+   * The largest payload to send (TCPConfig::MAX_PAYLOAD_SIZE by default). An MSS option from the receiver
+   * (on its SYN) can only lower it.
+   */
+  void set_MSS( uint64_t MSS );
+  uint64_t MSS() const { return _MSS; }
+
+  /*
+   * Packetization-layer path MTU discovery (RFC 4821): keep to the MSS there is now, and now and then send a
+   * larger message (a probe, of up to `max_MSS` bytes) when there's enough data for one. If the probe is
+   * acknowledged, that's the MSS from then on; if it is lost TCPConfig::MAX_PROBES times, the path doesn't
+   * take that size, and the search goes on below it. A lost probe isn't taken as congestion, and its data is
+   * sent again in messages of the MSS there is.
+   */
+  void set_path_MTU_discovery( uint64_t max_MSS );
+  uint64_t max_MSS() const { return _MSS_ceiling; } // the MSS, or the largest probe to send
+
+  // The receiver's windows are in units of 2^shift sequence numbers (RFC 7323), except the one on its SYN
+  // (the message with the window scale option), which is never scaled.
+  void set_window_scale( uint8_t shift ) { _window_shift = shift; }
   Writer& writer() { return input_.writer(); }
   const Writer& writer() const { return input_.writer(); }
 
@@ -97,13 +150,73 @@ private:
   uint64_t initial_RTO_ms_;
   uint64_t _RTO;                          // use for exponetial backoff.
   uint64_t _outstanding_sequence_numbers; // use for count how many sequence numbers are outstanding
-  std::deque<TCPSenderMessage> _outstanding_segments_collection; // store all the outstanding messages
+  // An outstanding message, and what the receiver's SACK blocks told about it.
+  struct Outstanding
+  {
+    TCPSenderMessage msg;
+    bool sacked {};                // the receiver holds it already, so it isn't sent again
+    bool lost {};                  // DUP_THRESH messages after it were SACKed: send it again at the next push
+    bool resent {};                // it was sent again for that reason already
+    bool retransmitted {};         // it was sent more than once, so its ACK tells nothing of the RTT (Karn)
+    uint64_t sent_at_ms {};        // when it was first sent
+    uint64_t delivered_at_send {}; // how many sequence numbers had been acknowledged then
+    bool probe {};                 // it's larger than the MSS, to find whether the path takes messages that size
+  };
+  std::deque<Outstanding> _outstanding_segments_collection; // store all the outstanding messages
   uint64_t _consecutive_retransmissions_times; // use for count how many consecutive *re*transmissions have
                                                // happened, use for exponential backoff
-  uint16_t _receiver_window_size;              // Receiver's window size
-  uint16_t _window_size;                       // Appearance window size
+  uint64_t _receiver_window_size;              // Receiver's window size (scaled up)
+  uint64_t _window_size;                       // Appearance window size
   timer _retransmission_timer;                 // true if the timer is running.
   bool _has_send_SYN;                          // detemine if have send SYN
   bool _has_send_FIN;                          // detemine if have send FIN
   uint64_t _pre_ack_ackno;                     // the biggest previous ACK ackno.
+  uint8_t _window_shift {};                    // the receiver's window scale
+
+  CongestionControl::Algorithm _congestion_algorithm;
+  std::unique_ptr<CongestionControl> _congestion_control; // nullptr: no congestion window
+  uint64_t _now_ms {};                                    // the sum of all the ticks
+  uint64_t _delivered {};                                 // sequence numbers acknowledged in all
+  uint64_t _recovery_point {};                            // losses before this seqno were already reacted to
+  bool _in_recovery {};                // a loss reduced the window, and what was sent then isn't all acked yet
+  unsigned _duplicate_acks {};         // duplicate ACKs in a row (counted with congestion control only)
+  uint64_t _recovery_inflation {};     // how far past the congestion window duplicate ACKs let the sender go
+
+  // RTT estimates, in microseconds so that short RTTs keep their precision.
+  std::optional<uint64_t> _smoothed_RTT_us {};
+  uint64_t _RTT_variation_us {};
+  bool _adaptive_RTO {};
+  uint64_t _RTO_min_ms {};
+  uint64_t _RTO_max_ms { UINT64_MAX };
+
+  // Pacing: when the next message may go, and the earliest that it would have gone with a finer clock.
+  bool _pacing {};
+  bool _paced_back {}; // push() held back a message
+  uint64_t _next_send_us {};
+  uint64_t _previous_tick_us {};
+
+  // Segment sizing: the MSS, the most the receiver and the path may take, and the probe to send next (if any).
+  uint64_t _MSS { TCPConfig::MAX_PAYLOAD_SIZE };
+  uint64_t _MSS_ceiling { TCPConfig::MAX_PAYLOAD_SIZE };
+  bool _MTU_discovery {};
+  uint64_t _probe_size {};
+  bool _probe_in_flight {};
+  unsigned _probe_failures {}; // losses of a probe of _probe_size
+
+  // change the MSS (and the congestion controller's), and choose the next probe.
+  void _change_MSS( uint64_t MSS );
+  void _next_probe();
+
+  // a probe was acknowledged (or SACKed), or it was taken as lost: then its data is split into messages of
+  // the MSS, to be sent again (returns the first of those, if there was a lost probe).
+  void _probe_acked( Outstanding& probe );
+  std::deque<Outstanding>::iterator _split_lost_probe();
+
+  // take in an RTT sample, and give the RTO the estimates make.
+  void _sample_RTT( uint64_t RTT_ms );
+  uint64_t _estimated_RTO() const;
+
+  // mark the outstanding messages that the SACK blocks cover, and the ones taken as lost because of them
+  // (returns true if any newly were).
+  bool _mark_sacked( const std::vector<std::pair<Wrap32, Wrap32>>& sack );
 };
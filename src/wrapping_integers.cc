@@ -1,40 +1,72 @@
 #include "wrapping_integers.hh"
-#include <cmath>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <span>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
-Wrap32 Wrap32::wrap( uint64_t n, Wrap32 zero_point )
+static_assert( sizeof( Wrap32 ) == sizeof( uint32_t ), "unwrap_many reads Wrap32s as raw 32-bit values" );
+
+namespace {
+
+void unwrap_scalar( span<const Wrap32> seqnos, Wrap32 zero_point, uint64_t checkpoint, span<uint64_t> out )
 {
-  // convert uint64_t n to a 32-bit unsigned integer, wrapping by 2^32
-  // uint32_t wrapped_n = n % (1ULL << 32);
-  uint32_t wrapped_n = static_cast<uint32_t>( n );
-  // use provide overwrite + operator.
-  return zero_point + wrapped_n;
+  for ( size_t i = 0; i < seqnos.size(); i++ ) {
+    out[i] = seqnos[i].unwrap( zero_point, checkpoint );
+  }
 }
 
-/* use for compute diff between two uint64_t number*/
-uint64_t abs_diff( uint64_t a, uint64_t b )
+#if defined( __x86_64__ )
+// The same arithmetic as Wrap32::unwrap, four values at a time: the 32-bit differences, sign-extended to 64
+// bits and added to the checkpoint, plus 2^32 in the lanes that came out below zero (and minus 2^32 in those
+// past 2^64 - 1). AVX2 only compares signed 64-bit lanes, so the unsigned comparisons with the checkpoint
+// flip the sign bits first.
+__attribute__( ( target( "avx2" ) ) ) void unwrap_avx2( span<const Wrap32> seqnos,
+                                                       Wrap32 zero_point,
+                                                       uint64_t checkpoint,
+                                                       span<uint64_t> out )
 {
-  return a > b ? a - b : b - a;
+  const uint32_t base = bit_cast<uint32_t>( zero_point ) + static_cast<uint32_t>( checkpoint );
+  const __m128i subtrahend = _mm_set1_epi32( static_cast<int>( base ) );
+  const __m256i checkpoints = _mm256_set1_epi64x( static_cast<int64_t>( checkpoint ) );
+  const __m256i wrap = _mm256_set1_epi64x( int64_t { 1 } << 32 );
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i sign = _mm256_set1_epi64x( INT64_MIN );
+  const __m256i signed_checkpoints = _mm256_xor_si256( checkpoints, sign );
+
+  size_t i = 0;
+  for ( ; i + 4 <= seqnos.size(); i += 4 ) {
+    const __m128i raw = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &seqnos[i] ) ); // NOLINT
+    const __m256i distance = _mm256_cvtepi32_epi64( _mm_sub_epi32( raw, subtrahend ) );
+    const __m256i nearest = _mm256_add_epi64( checkpoints, distance );
+    const __m256i signed_nearest = _mm256_xor_si256( nearest, sign );
+    const __m256i below_zero = _mm256_and_si256( _mm256_cmpgt_epi64( zero, distance ),
+                                                 _mm256_cmpgt_epi64( signed_nearest, signed_checkpoints ) );
+    const __m256i past_max = _mm256_and_si256( _mm256_cmpgt_epi64( distance, zero ),
+                                               _mm256_cmpgt_epi64( signed_checkpoints, signed_nearest ) );
+    const __m256i answer = _mm256_add_epi64( nearest, _mm256_and_si256( below_zero, wrap ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( &out[i] ), // NOLINT
+                         _mm256_sub_epi64( answer, _mm256_and_si256( past_max, wrap ) ) );
+  }
+  unwrap_scalar( seqnos.subspan( i ), zero_point, checkpoint, out.subspan( i ) );
 }
+#endif
+
+} // namespace
 
-uint64_t Wrap32::unwrap( Wrap32 zero_point, uint64_t checkpoint ) const
+void Wrap32::unwrap_many( span<const Wrap32> seqnos, Wrap32 zero_point, uint64_t checkpoint, span<uint64_t> out )
 {
-  // it's sure that this._raw_value is geq zero_point._raw_value
-  uint64_t n = this->_raw_value - zero_point._raw_value;
-
-  // there are three possible cases for n:
-  // add the first 32 bits of checkpoint to n
-  uint64_t n1 = n + ( checkpoint & 0xFFFFFFFF00000000 );
-  uint64_t n2 = n1 + ( 1ULL << 32 );
-  uint64_t n3 = n1 - ( 1ULL << 32 );
-
-  // compute the absolute difference between n and checkpoint for each case
-  uint64_t diff1 = abs_diff( n1, checkpoint );
-  uint64_t diff2 = abs_diff( n2, checkpoint );
-  uint64_t diff3 = abs_diff( n3, checkpoint );
-
-  // return the closest one to the checkpoint
-  return diff1 <= diff2 && diff1 <= diff3 ? n1 : diff2 <= diff1 && diff2 <= diff3 ? n2 : n3;
+#if defined( __x86_64__ )
+  static const bool has_avx2 = __builtin_cpu_supports( "avx2" );
+  if ( has_avx2 ) {
+    unwrap_avx2( seqnos, zero_point, checkpoint, out );
+    return;
+  }
+#endif
+  unwrap_scalar( seqnos, zero_point, checkpoint, out );
 }
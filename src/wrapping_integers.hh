@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 /*
  * The Wrap32 type represents a 32-bit unsigned integer that:
@@ -11,10 +12,10 @@
 class Wrap32
 {
 public:
-  explicit Wrap32( uint32_t raw_value ) : _raw_value( raw_value ) {}
+  explicit constexpr Wrap32( uint32_t raw_value ) : _raw_value( raw_value ) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point. */
-  static Wrap32 wrap( uint64_t n, Wrap32 zero_point );
+  static constexpr Wrap32 wrap( uint64_t n, Wrap32 zero_point ) { return zero_point + static_cast<uint32_t>( n ); }
 
   /*
    * The unwrap method returns an absolute sequence number that wraps to this Wrap32, given the zero point
@@ -23,10 +24,45 @@ public:
    * There are many possible absolute sequence numbers that all wrap to the same Wrap32.
    * The unwrap method should return the one that is closest to the checkpoint.
    */
-  uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const;
+  constexpr uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const
+  {
+    // the answer is the checkpoint plus the signed 32-bit distance to it (the nearest one below 2^31 away,
+    // or the one below the checkpoint at exactly 2^31)...
+    const uint32_t offset = _raw_value - zero_point._raw_value;
+    const auto distance = static_cast<int32_t>( offset - static_cast<uint32_t>( checkpoint ) );
+    const uint64_t nearest = checkpoint + static_cast<uint64_t>( static_cast<int64_t>( distance ) );
 
-  Wrap32 operator+( uint32_t n ) const { return Wrap32 { _raw_value + n }; }
-  bool operator==( const Wrap32& other ) const { return _raw_value == other._raw_value; }
+    // ...unless that would be below zero (or past 2^64 - 1), and then it's the one 2^32 higher (or lower).
+    const bool below_zero = ( distance < 0 ) & ( nearest > checkpoint );
+    const bool past_max = ( distance > 0 ) & ( nearest < checkpoint );
+    return nearest + ( static_cast<uint64_t>( below_zero ) << 32 ) - ( static_cast<uint64_t>( past_max ) << 32 );
+  }
+
+  /*
+   * Unwrap every one of `seqnos` into `out` (which must be as long), with the same zero point and checkpoint,
+   * several at a time where the CPU has vector instructions for it.
+   */
+  static void unwrap_many( std::span<const Wrap32> seqnos,
+                           Wrap32 zero_point,
+                           uint64_t checkpoint,
+                           std::span<uint64_t> out );
+
+  constexpr Wrap32 operator+( uint32_t n ) const { return Wrap32 { _raw_value + n }; }
+  constexpr bool operator==( const Wrap32& other ) const { return _raw_value == other._raw_value; }
+
+  /*
+   * Serial number arithmetic (RFC 1982): `a - b` is how far `a` is past `b`, from -2^31 to 2^31 - 1, and `a < b`
+   * means `a` comes before `b` going around the circle the short way. This ordering only makes sense between
+   * sequence numbers less than 2^31 apart (as those within one window are), and isn't transitive beyond that.
+   */
+  constexpr int32_t operator-( const Wrap32& other ) const
+  {
+    return static_cast<int32_t>( _raw_value - other._raw_value );
+  }
+  constexpr bool operator<( const Wrap32& other ) const { return *this - other < 0; }
+  constexpr bool operator<=( const Wrap32& other ) const { return *this - other <= 0; }
+  constexpr bool operator>( const Wrap32& other ) const { return other < *this; }
+  constexpr bool operator>=( const Wrap32& other ) const { return other <= *this; }
 
 protected:
   uint32_t _raw_value {};
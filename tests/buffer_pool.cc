@@ -0,0 +1,114 @@
+#include "buffer_pool.hh"
+#include "byte_stream.hh"
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// Many short-lived streams, one after another: only the first should need new memory.
+void short_lived_streams()
+{
+  const auto& stats = BufferPool::local().stats();
+  const string data( 3000, 'x' );
+
+  uint64_t mallocs_after_warmup = 0;
+  for ( int round = 0; round < 100; round++ ) {
+    ByteStream bs { 64000 };
+    for ( int i = 0; i < 30; i++ ) {
+      bs.writer().push( data );
+      bs.reader().pop( 2000 );
+    }
+    if ( round == 0 ) {
+      mallocs_after_warmup = stats.block_mallocs;
+    }
+  }
+
+  expect( stats.block_mallocs == mallocs_after_warmup, "rings are reused once the pool is warm" );
+  expect( stats.block_requests > stats.block_mallocs, "rings are drawn from the pool" );
+}
+
+// A Reassembler fed out-of-order segments of a fixed size reaches a state with no new string memory.
+void reassembler_steady_state()
+{
+  const auto& stats = BufferPool::local().stats();
+  constexpr size_t segment = 1000;
+  Reassembler reassembler { ByteStream { 16 * segment } };
+
+  uint64_t index = 0;
+  uint64_t mallocs_after_warmup = 0;
+  for ( int round = 0; round < 200; round++ ) {
+    // each round delivers segments 3, 1, 2, 0 of the next four.
+    for ( const uint64_t n : { 3, 1, 2, 0 } ) {
+      string payload = BufferPool::local().take_string( segment );
+      payload.assign( segment, static_cast<char>( 'a' + n ) );
+      reassembler.insert( index + n * segment, move( payload ), false );
+    }
+    index += 4 * segment;
+    expect( reassembler.reader().bytes_popped() + reassembler.reader().bytes_buffered() == index,
+            "all four segments were reassembled" );
+    reassembler.reader().pop( reassembler.reader().bytes_buffered() );
+
+    if ( round == 10 ) {
+      mallocs_after_warmup = stats.string_mallocs + stats.block_mallocs;
+    }
+  }
+
+  expect( stats.string_mallocs + stats.block_mallocs == mallocs_after_warmup,
+          "no new allocations once the reassembler reaches its steady state" );
+}
+
+// Direct writes into a chunked stream reuse their buffers, without filling them in again.
+void chunked_reserve_steady_state()
+{
+  const auto& stats = BufferPool::local().stats();
+  constexpr size_t segment = 1000;
+  ByteStream stream { 4 * segment, ByteStream::Storage::Chunked };
+
+  uint64_t mallocs_after_warmup = 0;
+  for ( int round = 0; round < 200; round++ ) {
+    const span<char> space = stream.writer().reserve( segment );
+    expect( space.size() == segment, "the whole reservation is handed out" );
+    if ( round > 10 ) {
+      expect( space[0] == 'a' + ( round - 1 ) % 26, "the buffer comes back as it was last written" );
+    }
+    fill( space.begin(), space.end(), static_cast<char>( 'a' + round % 26 ) );
+    stream.writer().commit( segment );
+    expect( stream.reader().peek() == string( segment, static_cast<char>( 'a' + round % 26 ) ),
+            "the committed bytes are read back" );
+    stream.reader().pop( segment );
+
+    if ( round == 10 ) {
+      mallocs_after_warmup = stats.string_mallocs + stats.block_mallocs;
+    }
+  }
+
+  expect( stats.string_mallocs + stats.block_mallocs == mallocs_after_warmup,
+          "no new allocations once the direct writes reach their steady state" );
+}
+
+int main()
+{
+  try {
+    short_lived_streams();
+    reassembler_steady_state();
+    chunked_reserve_steady_state();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+static constexpr auto chunked = ByteStream::Storage::Chunked;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "peek gives the whole front chunk", 15, chunked };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( BytesBuffered { 6 } );
+      test.execute( PeekOnce { "cat" } );
+      test.execute( Peek { "cattac" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "pop within and across chunks", 15, chunked };
+
+      test.execute( Push { "hello" } );
+      test.execute( Push { "world" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { "llo" } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekOnce { "orld" } );
+      test.execute( BytesPopped { 6 } );
+      test.execute( BytesBuffered { 4 } );
+      test.execute( AvailableCapacity { 11 } );
+      test.execute( Pop { 10 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( BytesPopped { 10 } );
+      test.execute( PeekOnce { "" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "partial chunk when capacity runs out", 4, chunked };
+
+      test.execute( Push { "abc" } );
+      test.execute( Push { "def" } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekOnce { "abc" } );
+      test.execute( Peek { "abcd" } );
+      test.execute( Push { "g" } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekOnce { "d" } );
+      test.execute( Push { "ghij" } );
+      test.execute( BytesPushed { 7 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "dghi" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "empty pushes are not stored", 4, chunked };
+
+      test.execute( Push { "" } );
+      test.execute( Push { "ab" } );
+      test.execute( Push { "" } );
+      test.execute( PeekOnce { "ab" } );
+      test.execute( Pop { 2 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( PeekOnce { "" } );
+    }
+
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
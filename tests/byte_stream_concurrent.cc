@@ -0,0 +1,95 @@
+#include "concurrent_byte_stream.hh"
+
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+void single_thread()
+{
+  ConcurrentByteStream bs { 4 };
+
+  expect( bs.writer().available_capacity() == 4, "available_capacity is 4 at start" );
+  bs.writer().push( "abc" );
+  expect( bs.reader().peek() == "abc", "peek gives \"abc\"" );
+  bs.reader().pop( 2 );
+  bs.writer().push( "defg" );
+  expect( bs.writer().bytes_pushed() == 6, "push stops at capacity" );
+  expect( bs.reader().peek() == "cd", "peek stops at the wrap point" );
+  bs.reader().pop( 2 );
+  expect( bs.reader().peek() == "ef", "peek continues after the wrap point" );
+  bs.writer().close();
+  expect( not bs.reader().is_finished(), "not finished while bytes remain" );
+  bs.reader().pop( 5 );
+  expect( bs.reader().bytes_popped() == 6, "pop stops at bytes buffered" );
+  expect( bs.reader().is_finished(), "finished after close and pop" );
+  bs.reader().wait(); // must not block once finished
+}
+
+void two_threads( const size_t input_len, const size_t capacity, const size_t random_seed )
+{
+  const string data = [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  ConcurrentByteStream bs { capacity };
+
+  thread writer_thread( [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<size_t> write_size { 1, capacity * 2 };
+    size_t written = 0;
+    while ( written < data.size() ) {
+      bs.writer().wait();
+      const auto before = bs.writer().bytes_pushed();
+      bs.writer().push( data.substr( written, write_size( rd ) ) );
+      written += bs.writer().bytes_pushed() - before;
+    }
+    bs.writer().close();
+  } );
+
+  string output;
+  while ( true ) {
+    bs.reader().wait();
+    if ( bs.reader().is_finished() ) {
+      break;
+    }
+    const auto peeked = bs.reader().peek();
+    output += peeked;
+    bs.reader().pop( peeked.size() );
+  }
+  writer_thread.join();
+
+  expect( output == data, "reader sees exactly the bytes written by the other thread" );
+}
+
+int main()
+{
+  try {
+    single_thread();
+    two_threads( 100000, 1, 1234 );
+    two_threads( 1000000, 17, 4321 );
+    two_threads( 1000000, 4096, 5678 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include "concurrent_byte_stream.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+string make_data( const size_t input_len, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < input_len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+double report( const string& name, const size_t input_len, const duration<double> test_duration )
+{
+  const auto gigabits_per_second = 8 * static_cast<double>( input_len ) / test_duration.count() / 1e9;
+
+  cout << name << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  return gigabits_per_second;
+}
+
+// The producer thread pushes `write_size` bytes at a time into a ConcurrentByteStream,
+// while this thread consumes them.
+double concurrent_speed( const string& data, const size_t capacity, const size_t write_size )
+{
+  ConcurrentByteStream bs { capacity };
+  string output_data;
+  output_data.resize( data.size() ); // fault in the pages now, so the timed loop measures the stream only
+  output_data.clear();
+
+  const auto start_time = steady_clock::now();
+  thread producer( [&] {
+    for ( size_t i = 0; i < data.size(); ) {
+      bs.writer().wait();
+      const auto before = bs.writer().bytes_pushed();
+      bs.writer().push( data.substr( i, write_size ) );
+      i += bs.writer().bytes_pushed() - before;
+    }
+    bs.writer().close();
+  } );
+
+  while ( true ) {
+    bs.reader().wait();
+    if ( bs.reader().is_finished() ) {
+      break;
+    }
+    const auto peeked = bs.reader().peek();
+    output_data += peeked;
+    bs.reader().pop( peeked.size() );
+  }
+  producer.join();
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (ConcurrentByteStream)" );
+  }
+
+  return report( "ConcurrentByteStream with capacity=" + to_string( capacity ) + ", write_size="
+                   + to_string( write_size ),
+                 data.size(),
+                 stop_time - start_time );
+}
+
+// The same transfer through an AF_UNIX socketpair, the way TCPMinnowSocket moves bytes between threads.
+double socketpair_speed( const string& data, const size_t capacity, const size_t write_size )
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  FileDescriptor producer_end { fds[0] };
+  FileDescriptor consumer_end { fds[1] };
+
+  string output_data;
+  output_data.resize( data.size() );
+  output_data.clear();
+  string buffer;
+
+  const auto start_time = steady_clock::now();
+  thread producer( [&] {
+    for ( size_t i = 0; i < data.size(); ) {
+      i += producer_end.write( string_view( data ).substr( i, write_size ) );
+    }
+    producer_end.close();
+  } );
+
+  while ( not consumer_end.eof() ) {
+    buffer.resize( capacity );
+    consumer_end.read( buffer );
+    output_data += buffer;
+  }
+  producer.join();
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (socketpair)" );
+  }
+
+  return report( "socketpair with read_size=" + to_string( capacity ) + ", write_size=" + to_string( write_size ),
+                 data.size(),
+                 stop_time - start_time );
+}
+
+void program_body()
+{
+  const string data = make_data( 1e8, 789 );
+
+  const auto concurrent = concurrent_speed( data, 65536, 1500 );
+  const auto socketpair = socketpair_speed( data, 65536, 1500 );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+  debug_output << "             ConcurrentByteStream throughput: " << fixed << setprecision( 2 ) << concurrent
+               << " Gbit/s (socketpair: " << socketpair << " Gbit/s)\n";
+
+  if ( concurrent < 0.1 ) {
+    throw runtime_error( "ConcurrentByteStream did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+static constexpr auto mapped = ByteStream::Storage::Mapped;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "mapped basics", 15, mapped };
+
+      test.execute( Push { "hello" } );
+      test.execute( BytesBuffered { 5 } );
+      test.execute( AvailableCapacity { 10 } );
+      test.execute( PeekOnce { "hello" } );
+      test.execute( Peek { "hello" } );
+      test.execute( Pop { 2 } );
+      test.execute( DirectWrite { " world" } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "llo world" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      const uint64_t ring = RingMemory::min_mapped_size();
+      const string first( ring - 3, 'x' );
+      ByteStreamTestHarness test { "peek runs across the wrap point", ring, mapped };
+
+      test.execute( Push { first } );
+      test.execute( Pop { first.size() } );
+      test.execute( Push { "abcdefgh" } );
+      test.execute( PeekOnce { "abcdefgh" } );
+      test.execute( PeekRegions { { "abcdefgh" } } );
+      test.execute( Pop { 4 } );
+      test.execute( ReserveSize { ring, ring - 4 } );
+      test.execute( DirectWrite { "ijkl" } );
+      test.execute( PeekOnce { "efghijkl" } );
+    }
+
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
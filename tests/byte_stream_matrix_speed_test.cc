@@ -0,0 +1,283 @@
+#include "buffer_pool.hh"
+#include "byte_stream.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * A sweep of ByteStream throughput over a grid of storages, capacities, write sizes, read sizes and
+ * interleavings of writes and reads. For each cell of the grid, it reports:
+ *   - the throughput, in Gbit/s;
+ *   - the number of heap allocations per write or read call;
+ *   - the 99th percentile of the time taken by one write call and by one read (peek + pop) call.
+ *
+ * The results are printed as JSON (to the file named by the first argument, if any, or to stdout), one
+ * object per cell, so that runs from different releases can be compared by a script.
+ */
+
+// Count every heap allocation made by this program.
+namespace {
+uint64_t allocation_count = 0; // NOLINT(*-avoid-non-const-global-variables)
+}
+
+void* operator new( size_t size )
+{
+  allocation_count++;
+  void* ptr = malloc( size ); // NOLINT(*-no-malloc, *-owning-memory)
+  if ( ptr == nullptr ) {
+    throw bad_alloc {};
+  }
+  return ptr;
+}
+
+void* operator new[]( size_t size )
+{
+  return operator new( size );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete[]( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete[]( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+enum class Interleaving
+{
+  Alternate, // one write, then one read, and again
+  FillDrain  // write until the stream is full, then read until it is empty, and again
+};
+
+struct Cell
+{
+  ByteStream::Storage storage;
+  uint64_t capacity;
+  size_t write_size;
+  size_t read_size;
+  Interleaving interleaving;
+};
+
+struct Result
+{
+  double gigabits_per_second {};
+  double allocations_per_call {};
+  uint64_t p99_write_ns {};
+  uint64_t p99_read_ns {};
+};
+
+string storage_name( ByteStream::Storage storage )
+{
+  switch ( storage ) {
+    case ByteStream::Storage::Ring:
+      return "ring";
+    case ByteStream::Storage::Chunked:
+      return "chunked";
+    case ByteStream::Storage::Mapped:
+      return "mapped";
+  }
+  return "unknown";
+}
+
+string interleaving_name( Interleaving interleaving )
+{
+  return interleaving == Interleaving::Alternate ? "alternate" : "fill_drain";
+}
+
+uint64_t p99( vector<uint64_t>& samples )
+{
+  if ( samples.empty() ) {
+    return 0;
+  }
+  const auto nth = samples.begin() + static_cast<ptrdiff_t>( samples.size() * 99 / 100 );
+  nth_element( samples.begin(), nth, samples.end() );
+  return *nth;
+}
+
+// Move `data` through a ByteStream, the way `cell` says. When `samples` are given, each write and
+// read call is timed on its own (which slows the whole run down, so the throughput of such a run means little).
+Result run( const Cell& cell, string_view data, string& output, array<vector<uint64_t>, 2>* samples )
+{
+  ByteStream bs { cell.capacity, cell.storage };
+  Writer& writer = bs.writer();
+  Reader& reader = bs.reader();
+  output.clear();
+
+  uint64_t written = 0;
+  uint64_t calls = 0;
+
+  const auto write_once = [&] {
+    const size_t len = min( { cell.write_size, data.size() - written, writer.available_capacity() } );
+    string piece = BufferPool::local().take_string( len );
+    piece.assign( data.substr( written, len ) );
+
+    const auto start = samples ? steady_clock::now() : steady_clock::time_point {};
+    writer.push( move( piece ) );
+    if ( samples ) {
+      ( *samples )[0].push_back( duration_cast<nanoseconds>( steady_clock::now() - start ).count() );
+    }
+    written += len;
+    calls++;
+  };
+
+  const auto read_once = [&] {
+    const auto start = samples ? steady_clock::now() : steady_clock::time_point {};
+    const string_view peeked = reader.peek().substr( 0, cell.read_size );
+    output.append( peeked );
+    reader.pop( peeked.size() );
+    if ( samples ) {
+      ( *samples )[1].push_back( duration_cast<nanoseconds>( steady_clock::now() - start ).count() );
+    }
+    calls++;
+  };
+
+  const uint64_t allocations_before = allocation_count;
+  const auto start_time = steady_clock::now();
+  while ( written < data.size() or reader.bytes_buffered() ) {
+    if ( cell.interleaving == Interleaving::Alternate ) {
+      if ( written < data.size() and writer.available_capacity() ) {
+        write_once();
+      }
+      if ( reader.bytes_buffered() ) {
+        read_once();
+      }
+    } else {
+      while ( written < data.size() and writer.available_capacity() ) {
+        write_once();
+      }
+      while ( reader.bytes_buffered() ) {
+        read_once();
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  const uint64_t allocations = allocation_count - allocations_before;
+
+  if ( output != data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  Result result;
+  result.gigabits_per_second
+    = 8 * static_cast<double>( data.size() ) / duration<double>( stop_time - start_time ).count() / 1e9;
+  result.allocations_per_call = static_cast<double>( allocations ) / static_cast<double>( max( calls, 1UL ) );
+  if ( samples ) {
+    result.p99_write_ns = p99( ( *samples )[0] );
+    result.p99_read_ns = p99( ( *samples )[1] );
+  }
+  return result;
+}
+
+// Enough bytes to time a cell well, without spending long on the cells made of 1-byte calls.
+size_t bytes_for( const Cell& cell )
+{
+  return clamp( min( cell.write_size, cell.read_size ) << 16, size_t { 1 } << 19, size_t { 1 } << 24 );
+}
+
+void program_body( ostream& json )
+{
+  const string data = [] {
+    default_random_engine rd { 789 };
+    uniform_int_distribution<char> ud;
+    string ret( size_t { 1 } << 24, 0 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+
+  string output;
+  output.resize( data.size() ); // fault in the pages now, so the timed loops measure the ByteStream only
+  output.clear();
+
+  vector<Cell> cells;
+  for ( const auto storage :
+        { ByteStream::Storage::Ring, ByteStream::Storage::Chunked, ByteStream::Storage::Mapped } ) {
+    for ( const uint64_t capacity : { 65536UL, 1UL << 22 } ) {
+      for ( const size_t write_size : { 1UL, 1460UL, 1UL << 20 } ) {
+        for ( const size_t read_size : { 1UL, 1460UL, 65536UL } ) {
+          for ( const auto interleaving : { Interleaving::Alternate, Interleaving::FillDrain } ) {
+            cells.push_back( { storage, capacity, write_size, read_size, interleaving } );
+          }
+        }
+      }
+    }
+  }
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  double slowest = 1e9;
+  json << "[\n";
+  for ( size_t i = 0; i < cells.size(); i++ ) {
+    const Cell& cell = cells[i];
+    const string_view cell_data = string_view( data ).substr( 0, bytes_for( cell ) );
+
+    // warm up the BufferPool, then measure throughput and allocations, then latency.
+    run( cell, cell_data.substr( 0, cell_data.size() / 8 ), output, nullptr );
+    Result result = run( cell, cell_data, output, nullptr );
+    array<vector<uint64_t>, 2> samples;
+    const Result timed = run( cell, cell_data.substr( 0, cell_data.size() / 4 ), output, &samples );
+    result.p99_write_ns = timed.p99_write_ns;
+    result.p99_read_ns = timed.p99_read_ns;
+    slowest = min( slowest, result.gigabits_per_second );
+
+    json << "  { \"storage\": \"" << storage_name( cell.storage ) << "\", \"capacity\": " << cell.capacity
+         << ", \"write_size\": " << cell.write_size << ", \"read_size\": " << cell.read_size
+         << ", \"interleaving\": \"" << interleaving_name( cell.interleaving ) << "\", \"bytes\": "
+         << cell_data.size() << ", \"gbit_per_s\": " << fixed << setprecision( 3 ) << result.gigabits_per_second
+         << ", \"allocations_per_call\": " << setprecision( 4 ) << result.allocations_per_call
+         << ", \"p99_write_ns\": " << result.p99_write_ns << ", \"p99_read_ns\": " << result.p99_read_ns << " }"
+         << ( i + 1 < cells.size() ? "," : "" ) << "\n";
+  }
+  json << "]\n";
+
+  debug_output << "             ByteStream matrix: " << cells.size() << " cells, slowest " << fixed
+               << setprecision( 2 ) << slowest << " Gbit/s\n";
+
+  if ( slowest < 0.01 ) {
+    throw runtime_error( "ByteStream did not meet minimum speed of 0.01 Gbit/s in every cell." );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc > 1 ) {
+      ofstream json { argv[1] }; // NOLINT(*-pointer-arithmetic)
+      program_body( json );
+    } else {
+      program_body( cout );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
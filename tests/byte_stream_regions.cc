@@ -0,0 +1,53 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "empty stream has no regions", 4 };
+
+      test.execute( PeekRegions { {} } );
+      test.execute( Push { "ab" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekRegions { {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring regions split at the wrap point", 4 };
+
+      test.execute( Push { "abc" } );
+      test.execute( PeekRegions { { "abc" } } );
+      test.execute( Pop { 2 } );
+      test.execute( Push { "def" } );
+      test.execute( PeekOnce { "cd" } );
+      test.execute( PeekRegions { { "cd", "ef" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekRegions { { "f" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "one region per chunk", 10, ByteStream::Storage::Chunked };
+
+      test.execute( Push { "abc" } );
+      test.execute( Push { "de" } );
+      test.execute( Push { "fghijk" } );
+      test.execute( PeekRegions { { "abc", "de", "fghij" } } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekRegions { { "e", "fghij" } } );
+      test.execute( Pop { 1 } );
+      test.execute( PeekRegions { { "fghij" } } );
+    }
+
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
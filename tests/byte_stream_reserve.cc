@@ -0,0 +1,107 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "reserve then commit", 15 };
+
+      test.execute( DirectWrite { "hello" } );
+      test.execute( BytesPushed { 5 } );
+      test.execute( AvailableCapacity { 10 } );
+      test.execute( Peek { "hello" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "commit less than reserved", 15 };
+
+      test.execute( DirectWrite { "hello", 2 } );
+      test.execute( BytesPushed { 2 } );
+      test.execute( BytesBuffered { 2 } );
+      test.execute( DirectWrite { "y" } );
+      test.execute( Peek { "hey" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "nothing is visible before commit", 15 };
+
+      test.execute( ReserveSize { 4, 4 } );
+      test.execute( BytesPushed { 0 } );
+      test.execute( BufferEmpty { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "reserve is bounded by available capacity", 4 };
+
+      test.execute( ReserveSize { 10, 4 } );
+      test.execute( DirectWrite { "abcdef" } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( ReserveSize { 1, 0 } );
+      test.execute( Peek { "abcd" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring reservation stops at the wrap point", 4 };
+
+      test.execute( Push { "abc" } );
+      test.execute( Pop { 2 } );
+      test.execute( ReserveSize { 3, 1 } );
+      test.execute( DirectWrite { "defg" } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( DirectWrite { "efg" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Peek { "cdef" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked reserve becomes one chunk", 4, ByteStream::Storage::Chunked };
+
+      test.execute( DirectWrite { "ab" } );
+      test.execute( DirectWrite { "cdef", 1 } );
+      test.execute( BytesPushed { 3 } );
+      test.execute( PeekOnce { "ab" } );
+      test.execute( PeekRegions { { "ab", "c" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "write_at out of order, then commit", 8 };
+
+      test.execute( WriteAt { 3, "def" } );
+      test.execute( BytesPushed { 0 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( WriteAt { 0, "abc" } );
+      test.execute( Commit { 6 } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( Peek { "abcdef" } );
+      test.execute( WriteAt { 1, "hijk" } );
+      test.execute( WriteAt { 0, "g" } );
+      test.execute( Commit { 5 } );
+      test.execute( BytesPushed { 8 } );
+      test.execute( Peek { "abcdefgh" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "write_at across the wrap", 8, ByteStream::Storage::Mapped };
+
+      test.execute( Push { "012345" } );
+      test.execute( Pop { 6 } );
+      test.execute( WriteAt { 2, "cdef" } );
+      test.execute( WriteAt { 0, "ab" } );
+      test.execute( Commit { 6 } );
+      test.execute( PeekOnce { "abcdef" } );
+    }
+
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "byte_stream.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr auto chunked = ByteStream::Storage::Chunked;
+static constexpr auto ring = ByteStream::Storage::Ring;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+string read_all( Reader& reader )
+{
+  string out;
+  while ( reader.bytes_buffered() ) {
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+  return out;
+}
+
+// Splicing between Chunked streams hands over the chunks, cutting the last one if needed.
+void splice_chunks()
+{
+  ByteStream from { 100, chunked };
+  ByteStream to { 100, chunked };
+  from.writer().push( "hello" );
+  from.writer().push( "world" );
+
+  to.writer().splice_from( from.reader(), 7 );
+  expect( from.reader().bytes_popped() == 7, "source popped what was spliced" );
+  expect( to.writer().bytes_pushed() == 7, "destination pushed what was spliced" );
+  expect( to.reader().peek() == "hello", "first chunk handed over whole" );
+  to.reader().pop( 5 );
+  expect( to.reader().peek() == "wo", "second chunk cut at the splice length" );
+  expect( from.reader().peek() == "rld", "rest of the second chunk stays in the source" );
+  expect( to.reader().peek().data() + 2 == from.reader().peek().data(), // NOLINT(*-pointer-arithmetic)
+          "the two streams share the second chunk's bytes" );
+}
+
+// Teeing shares the bytes, and each stream reads them independently.
+void tee_chunks()
+{
+  ByteStream from { 100, chunked };
+  ByteStream to { 100, chunked };
+  from.writer().push( "abcdef" );
+
+  to.writer().tee_from( from.reader(), 100 );
+  expect( from.reader().bytes_buffered() == 6, "tee leaves the source alone" );
+  expect( to.reader().peek().data() == from.reader().peek().data(), "tee shares the chunk" );
+
+  from.reader().pop( 2 );
+  expect( to.reader().peek() == "abcdef", "popping the source doesn't touch the copy" );
+  expect( read_all( to.reader() ) == "abcdef", "copy reads everything" );
+  expect( read_all( from.reader() ) == "cdef", "source reads the rest" );
+}
+
+// Between other kinds of storage, the bytes are copied (across the ring's wrap too).
+void splice_copies()
+{
+  ByteStream from { 16, ring };
+  ByteStream to { 64, chunked };
+  from.writer().push( string( 12, 'x' ) );
+  from.reader().pop( 12 );
+  from.writer().push( "0123456789" ); // wraps around the 16-byte ring
+
+  to.writer().splice_from( from.reader(), 8 );
+  expect( read_all( to.reader() ) == "01234567", "ring to chunked" );
+  expect( from.reader().peek() == "89", "rest stays in the ring" );
+
+  ByteStream back { 64, ring };
+  back.writer().push( "ab" );
+  to.writer().push( "cd" );
+  to.writer().push( "ef" );
+  back.writer().tee_from( to.reader(), 100 );
+  expect( read_all( back.reader() ) == "abcdef", "chunked to ring" );
+  expect( to.reader().bytes_buffered() == 4, "tee left the chunked stream alone" );
+}
+
+// Transfers stop at the destination's available capacity and the source's buffered bytes.
+void clamped()
+{
+  ByteStream from { 100, chunked };
+  ByteStream to { 5, chunked };
+  from.writer().push( "abc" );
+  from.writer().push( "defgh" );
+
+  to.writer().splice_from( from.reader(), 100 );
+  expect( to.writer().available_capacity() == 0, "destination filled up" );
+  expect( from.reader().bytes_buffered() == 3, "source kept what didn't fit" );
+  expect( read_all( to.reader() ) == "abcde", "destination got the first bytes" );
+
+  to.writer().splice_from( from.reader(), 100 );
+  expect( read_all( to.reader() ) == "fgh", "and then the rest" );
+  expect( from.reader().bytes_buffered() == 0, "source is empty" );
+  to.writer().splice_from( from.reader(), 100 );
+  expect( to.writer().bytes_pushed() == 8, "nothing more to splice" );
+}
+
+int main()
+{
+  try {
+    splice_chunks();
+    tee_chunks();
+    splice_copies();
+    clamped();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -5,9 +5,10 @@
 
 using namespace std;
 
-void stress_test( const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
-                  const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-                  const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+void stress_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+                  const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                  const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                  const ByteStream::Storage storage = ByteStream::Storage::Ring )
 {
   default_random_engine rd { random_seed };
 
@@ -21,7 +22,8 @@ void stress_test( const size_t input_len,    // NOLINT(bugprone-easily-swappable
   }();
 
   ByteStreamTestHarness bs { "stress test input=" + to_string( input_len ) + ", capacity=" + to_string( capacity ),
-                             capacity };
+                             capacity,
+                             storage };
 
   size_t expected_bytes_pushed {};
   size_t expected_bytes_popped {};
@@ -76,6 +78,12 @@ void program_body()
   stress_test( 18, 17, 12345 );
   stress_test( 1111, 17, 98765 );
   stress_test( 4097, 4096, 11101 );
+
+  stress_test( 1111, 17, 98765, ByteStream::Storage::Chunked );
+  stress_test( 4097, 4096, 11101, ByteStream::Storage::Chunked );
+
+  stress_test( 1111, 17, 98765, ByteStream::Storage::Mapped );
+  stress_test( 40000, 4096, 11101, ByteStream::Storage::Mapped );
 }
 
 int main()
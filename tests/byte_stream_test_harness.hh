@@ -3,9 +3,11 @@
 #include "byte_stream.hh"
 #include "common.hh"
 
+#include <algorithm>
 #include <concepts>
 #include <optional>
 #include <utility>
+#include <vector>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Reader." );
@@ -20,6 +22,24 @@ public:
     : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
   {}
 
+  ByteStreamTestHarness( std::string test_name, uint64_t capacity, ByteStream::Storage storage )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", storage=" + storage_name( storage ),
+                   ByteStream { capacity, storage } )
+  {}
+
+  static std::string storage_name( ByteStream::Storage storage )
+  {
+    switch ( storage ) {
+      case ByteStream::Storage::Chunked:
+        return "chunked";
+      case ByteStream::Storage::Mapped:
+        return "mapped";
+      default:
+        return "ring";
+    }
+  }
+
   size_t peek_size() { return object().reader().peek().size(); }
 };
 
@@ -34,6 +54,74 @@ struct Push : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.writer().push( data_ ); }
 };
 
+struct DirectWrite : public Action<ByteStream>
+{
+  std::string data_;
+  size_t commit_;
+
+  explicit DirectWrite( std::string data ) : data_( move( data ) ), commit_( data_.size() ) {}
+  DirectWrite( std::string data, size_t commit ) : data_( move( data ) ), commit_( commit ) {}
+
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( data_.size() ) + " ), write \"" + Printer::prettify( data_ )
+           + "\" there, commit( " + std::to_string( commit_ ) + " )";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto space = bs.writer().reserve( data_.size() );
+    std::copy_n( data_.begin(), std::min( space.size(), data_.size() ), space.begin() );
+    bs.writer().commit( std::min( space.size(), commit_ ) );
+  }
+};
+
+struct ReserveSize : public Expectation<ByteStream>
+{
+  size_t request_;
+  size_t size_;
+
+  ReserveSize( size_t request, size_t size ) : request_( request ), size_( size ) {}
+
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( request_ ) + " ) gives " + std::to_string( size_ ) + " bytes";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto got = bs.writer().reserve( request_ ).size();
+    bs.writer().commit( 0 );
+    if ( got != size_ ) {
+      throw ExpectationViolation { "reserve( " + std::to_string( request_ ) + " ).size()", size_, got };
+    }
+  }
+};
+
+struct WriteAt : public Action<ByteStream>
+{
+  uint64_t offset_;
+  std::string data_;
+
+  WriteAt( uint64_t offset, std::string data ) : offset_( offset ), data_( move( data ) ) {}
+
+  std::string description() const override
+  {
+    return "write_at( " + std::to_string( offset_ ) + ", \"" + Printer::prettify( data_ ) + "\" )";
+  }
+
+  void execute( ByteStream& bs ) const override { bs.writer().write_at( offset_, data_ ); }
+};
+
+struct Commit : public Action<ByteStream>
+{
+  uint64_t k_;
+
+  explicit Commit( uint64_t k ) : k_( k ) {}
+  std::string description() const override { return "commit( " + std::to_string( k_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.writer().commit( k_ ); }
+};
+
 struct Close : public Action<ByteStream>
 {
   std::string description() const override { return "close"; }
@@ -107,6 +195,33 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekRegions : public Expectation<ByteStream>
+{
+  std::vector<std::string> output_;
+
+  explicit PeekRegions( std::vector<std::string> output ) : output_( move( output ) ) {}
+
+  static std::string describe( const auto& regions )
+  {
+    std::string ret = "[";
+    for ( const auto& region : regions ) {
+      ret += ( ret.size() > 1 ? ", \"" : "\"" ) + Printer::prettify( region ) + "\"";
+    }
+    return ret + "]";
+  }
+
+  std::string description() const override { return "peek_regions() gives " + describe( output_ ); }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto regions = bs.reader().peek_regions();
+    if ( not std::equal( regions.begin(), regions.end(), output_.begin(), output_.end() ) ) {
+      throw ExpectationViolation { "Expected regions " + describe( output_ ) + ", but found "
+                                   + describe( regions ) };
+    }
+  }
+};
+
 struct IsClosed : public ConstExpectBool<ByteStream>
 {
   using ConstExpectBool::ConstExpectBool;
@@ -0,0 +1,115 @@
+#include "byte_stream.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// By default, the Writer is writable whenever there is room.
+void default_watermarks()
+{
+  ByteStream bs { 4 };
+  expect( bs.writer().is_writable(), "empty stream is writable" );
+  bs.writer().push( "abc" );
+  expect( bs.writer().is_writable(), "one byte of room is enough" );
+  bs.writer().push( "d" );
+  expect( not bs.writer().is_writable(), "full stream isn't writable" );
+  bs.reader().pop( 1 );
+  expect( bs.writer().is_writable(), "one byte of room again" );
+
+  ByteStream none { 0 };
+  expect( not none.writer().is_writable(), "zero-capacity stream is never writable" );
+}
+
+// Between the watermarks, writability depends on which one was crossed last.
+void hysteresis()
+{
+  ByteStream bs { 10 };
+  bs.set_watermarks( 3, 8 );
+
+  int writable_calls = 0;
+  bs.writer().on_writable( [&] { writable_calls++; } );
+
+  bs.writer().push( "1234567" );
+  expect( bs.writer().is_writable(), "below the high watermark" );
+  bs.writer().push( "8" );
+  expect( not bs.writer().is_writable(), "reached the high watermark" );
+  expect( bs.writer().available_capacity() == 2, "there is still room, though" );
+
+  bs.reader().pop( 1 );
+  bs.reader().pop( 3 );
+  expect( not bs.writer().is_writable(), "still above the low watermark" );
+  expect( writable_calls == 0, "no callback yet" );
+
+  bs.reader().pop( 1 );
+  expect( bs.writer().is_writable(), "drained down to the low watermark" );
+  expect( writable_calls == 1, "callback ran once" );
+
+  bs.reader().pop( 3 );
+  bs.writer().push( "ab" );
+  expect( writable_calls == 1, "no callback while already writable" );
+  expect( bs.writer().is_writable(), "still writable" );
+}
+
+// The readable callback runs when an empty stream gets bytes, or gets closed.
+void readable_callback()
+{
+  ByteStream bs { 10, ByteStream::Storage::Chunked };
+  int readable_calls = 0;
+  bs.reader().on_readable( [&] { readable_calls++; } );
+
+  expect( not bs.reader().is_readable(), "nothing to read yet" );
+  bs.writer().push( "" );
+  expect( readable_calls == 0, "empty push isn't readable" );
+  bs.writer().push( "ab" );
+  bs.writer().push( "cd" );
+  expect( bs.reader().is_readable(), "bytes to read" );
+  expect( readable_calls == 1, "callback ran once for two pushes" );
+
+  bs.reader().pop( 4 );
+  expect( not bs.reader().is_readable(), "drained" );
+  bs.writer().commit( 0 );
+  expect( readable_calls == 1, "empty commit isn't readable" );
+  bs.writer().close();
+  expect( bs.reader().is_readable(), "the end of the stream is readable" );
+  expect( readable_calls == 2, "callback ran on close" );
+}
+
+void bad_watermarks()
+{
+  ByteStream bs { 10 };
+  for ( const auto& [low, high] : { pair { 5, 5 }, pair { 6, 5 }, pair { 0, 11 } } ) {
+    bool threw = false;
+    try {
+      bs.set_watermarks( low, high );
+    } catch ( const invalid_argument& ) {
+      threw = true;
+    }
+    expect( threw, "watermarks " + to_string( low ) + ", " + to_string( high ) + " are rejected" );
+  }
+}
+
+int main()
+{
+  try {
+    default_watermarks();
+    hysteresis();
+    readable_callback();
+    bad_watermarks();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
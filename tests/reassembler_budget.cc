@@ -0,0 +1,113 @@
+#include "reassembler.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+string read_all( Reader& reader )
+{
+  string out;
+  while ( reader.bytes_buffered() ) {
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+  return out;
+}
+
+// Past its own budget, a Reassembler drops the bytes furthest out (in place, the new ones), and still
+// reassembles the rest.
+void own_budget( ByteStream::Storage storage )
+{
+  const string description = "storage " + to_string( static_cast<int>( storage ) ) + ": ";
+  Reassembler reassembler { ByteStream { 100, storage } };
+  reassembler.set_memory_limit( 10 );
+
+  reassembler.insert( 20, "klmnopqr", false );
+  reassembler.insert( 50, "0123456789", false );
+  expect( reassembler.bytes_pending() == 10, description + "within the budget" );
+  expect( reassembler.bytes_evicted() == 8, description + "evicted the excess" );
+  expect( reassembler.buffered_end_index() == 52, description + "from the end" );
+  expect( reassembler.hole_count() == 2, description + "both runs left" );
+
+  reassembler.insert( 60, "abcdefghij", false );
+  expect( reassembler.bytes_evicted() == 18, description + "new bytes past the rest are evicted first" );
+  expect( reassembler.buffered_end_index() == 52, description + "nothing stored past 52" );
+
+  reassembler.insert( 40, "ABCDEFGHIJ", false );
+  expect( reassembler.bytes_pending() == 10, description + "still within the budget" );
+  expect( reassembler.bytes_evicted() == 28, description + "dropped as many bytes" );
+  expect( reassembler.hole_count() == 2, description + "two runs again" );
+  if ( storage == ByteStream::Storage::Chunked ) {
+    expect( reassembler.buffered_end_index() == 42, description + "evicted the whole last run, then some more" );
+  } else {
+    // (in place, evicting would free no memory, and the new bytes are refused instead, nearer or not.)
+    expect( reassembler.buffered_end_index() == 52, description + "refused the new bytes" );
+  }
+
+  reassembler.insert( 0, "abcdefghijklmnopqrst", false );
+  expect( read_all( reassembler.reader() ) == "abcdefghijklmnopqrstklmnopqr",
+          description + "reassembled what was kept" );
+  expect( reassembler.bytes_pending() == 2, description + "two bytes wait for the gap" );
+  reassembler.insert( 28, "0123456789xyABCDEFGHIJ01", true );
+  expect( read_all( reassembler.reader() ) == "0123456789xyABCDEFGHIJ01",
+          description + "then the rest, sent again" );
+  expect( reassembler.writer().is_closed(), description + "closed" );
+}
+
+// The global budget is shared by every Reassembler: the bytes furthest ahead of their stream go first,
+// whichever Reassembler holds them (and in place, new bytes are refused instead).
+void global_budget()
+{
+  const uint64_t evicted_before = Reassembler::global_bytes_evicted();
+  Reassembler::set_global_memory_limit( 15 );
+  {
+    Reassembler first { ByteStream { 100, ByteStream::Storage::Chunked } };
+    Reassembler second { ByteStream { 100, ByteStream::Storage::Chunked } };
+    Reassembler third { ByteStream { 100 } };
+
+    first.insert( 50, "0123456789", false );
+    expect( Reassembler::global_bytes_pending() == 10, "first one within the global budget" );
+    second.insert( 10, "0123456789", false );
+    expect( Reassembler::global_bytes_pending() == 15, "second one evicted down to the global budget" );
+    expect( first.bytes_pending() == 5 and second.bytes_pending() == 10, "from the first one, further ahead" );
+    expect( first.buffered_end_index() == 55, "from the end of the first one's bytes" );
+    third.insert( 10, "0123456789", false );
+    expect( third.bytes_pending() == 0 and third.bytes_evicted() == 10, "in place, the new bytes are refused" );
+    expect( Reassembler::global_bytes_evicted() - evicted_before == 15, "global count of evicted bytes" );
+
+    Reassembler moved { std::move( second ) };
+    expect( Reassembler::global_bytes_pending() == 15, "moving a Reassembler doesn't change the total" );
+    Reassembler::set_global_memory_limit( 10 );
+    moved.insert( 30, "abcde", false );
+    expect( first.bytes_pending() == 0 and moved.bytes_pending() == 10, "the moved one is evicted from too" );
+    expect( moved.buffered_end_index() == 20, "then its own bytes furthest ahead" );
+  }
+  expect( Reassembler::global_bytes_pending() == 0, "destroyed Reassemblers don't count" );
+  Reassembler::set_global_memory_limit( UINT64_MAX );
+}
+
+int main()
+{
+  try {
+    for ( const auto storage :
+          { ByteStream::Storage::Chunked, ByteStream::Storage::Ring, ByteStream::Storage::Mapped } ) {
+      own_budget( storage );
+    }
+    global_budget();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -61,22 +61,30 @@ int main()
 
       test.execute( Insert { "b", 1 } );
       test.execute( BytesPushed( 0 ) );
+      test.execute( HoleCount( 1 ) );
+      test.execute( BufferedEndIndex( 2 ) );
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { false } );
 
       test.execute( Insert { "d", 3 } );
       test.execute( BytesPushed( 0 ) );
+      test.execute( HoleCount( 2 ) );
+      test.execute( BufferedEndIndex( 4 ) );
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { false } );
 
       test.execute( Insert { "c", 2 } );
       test.execute( BytesPushed( 0 ) );
+      test.execute( HoleCount( 1 ) );
+      test.execute( BytesPending( 3 ) );
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { false } );
 
       test.execute( Insert { "a", 0 } );
 
       test.execute( BytesPushed( 4 ) );
+      test.execute( HoleCount( 0 ) );
+      test.execute( BufferedEndIndex( 4 ) );
       test.execute( ReadAll( "abcd" ) );
       test.execute( IsFinished { false } );
     }
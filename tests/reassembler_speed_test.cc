@@ -9,6 +9,8 @@
 #include <queue>
 #include <random>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
@@ -82,9 +84,82 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   }
 }
 
+// Heavy reordering: in each window (as many segments as fit in `capacity` bytes), every other segment
+// arrives first, leaving hundreds of holes. Then the holes are filled from the last to the first, by
+// segments that also overlap their neighbours.
+void adversarial_speed_test( const size_t num_windows,  // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t segment_size, // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+{
+  const size_t segments_per_window = capacity / segment_size;
+  const size_t window_size = segments_per_window * segment_size;
+  const size_t overlap = segment_size / 10;
+
+  const string data = [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < num_windows * window_size; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  vector<pair<uint64_t, string>> split_data;
+  for ( size_t window = 0; window < num_windows; ++window ) {
+    const size_t base = window * window_size;
+    for ( size_t k = 1; k < segments_per_window; k += 2 ) {
+      split_data.emplace_back( base + k * segment_size, data.substr( base + k * segment_size, segment_size ) );
+    }
+    for ( size_t k = ( segments_per_window + 1 ) / 2; k-- > 0; ) {
+      const size_t first = base + 2 * k * segment_size;
+      const size_t start = first == 0 ? first : first - overlap;
+      split_data.emplace_back( start, data.substr( start, segment_size + overlap + ( first - start ) ) );
+    }
+  }
+
+  Reassembler reassembler { ByteStream { capacity } };
+
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const auto start_time = steady_clock::now();
+  for ( auto& [index, segment] : split_data ) {
+    reassembler.insert( index, move( segment ), false );
+
+    while ( reassembler.reader().bytes_buffered() ) {
+      output_data += reassembler.reader().peek();
+      reassembler.reader().pop( output_data.size() - reassembler.reader().bytes_popped() );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (adversarial)" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabits_per_second = 8 * static_cast<double>( output_data.size() ) / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Reassembler with capacity=" << capacity << ", " << segments_per_window / 2
+       << " holes per window reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             Reassembler throughput (heavy reordering): " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s under heavy reordering." );
+  }
+}
+
 void program_body()
 {
   speed_test( 10000, 1500, 1370 );
+  adversarial_speed_test( 64, 1 << 20, 1000, 1371 );
 }
 
 int main()
@@ -0,0 +1,122 @@
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// Random overlapping segments into a Reassembler over each kind of stream (Chunked keeps pieces, Ring and
+// Mapped reassemble in place), checked against a model that tracks which bytes have arrived. The segments
+// are inserted one by one, or `batch` at a time with insert_batch.
+void random_segments( const ByteStream::Storage storage,
+                      const uint64_t capacity,
+                      const size_t seed,
+                      const size_t batch )
+{
+  default_random_engine rd { seed };
+  const string data = [&rd] {
+    uniform_int_distribution<char> ud;
+    string ret( 20000, 0 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+
+  Reassembler reassembler { ByteStream { capacity, storage } };
+  vector<char> arrived( data.size() ); // (not vector<bool>, which is slow to index without optimizations)
+  uint64_t assembled = 0;
+  uint64_t pending = 0;
+  uint64_t highest = 0;
+  string output;
+  uint64_t rounds = 0;
+
+  const auto description = "storage " + to_string( static_cast<int>( storage ) ) + ", capacity "
+                           + to_string( capacity ) + ", seed " + to_string( seed ) + ", batch "
+                           + to_string( batch ) + ": ";
+
+  while ( not reassembler.reader().is_finished() ) {
+    // segments somewhere around the window, sometimes starting before what was already assembled.
+    const uint64_t window_end = assembled + reassembler.writer().available_capacity();
+    vector<Reassembler::Segment> segments;
+    for ( size_t k = 0; k < batch; k++ ) {
+      uniform_int_distribution<uint64_t> first_dist { assembled > 200 ? assembled - 200 : 0, window_end + 100 };
+      const uint64_t first = min( first_dist( rd ), static_cast<uint64_t>( data.size() ) );
+      const uint64_t len = min( uniform_int_distribution<uint64_t> { 0, 700 }( rd ), data.size() - first );
+      segments.push_back( { first, data.substr( first, len ), first + len == data.size() } );
+
+      for ( uint64_t i = max( first, assembled ); i < min( first + len, window_end ); i++ ) {
+        pending += not arrived[i];
+        arrived[i] = true;
+        highest = max( highest, i + 1 );
+      }
+    }
+    if ( batch == 1 ) {
+      reassembler.insert( segments[0].first_index, move( segments[0].data ), segments[0].is_last_substring );
+    } else {
+      reassembler.insert_batch( segments );
+    }
+    while ( assembled < data.size() and arrived[assembled] ) {
+      assembled++;
+      pending--;
+    }
+
+    expect( reassembler.writer().bytes_pushed() == assembled, description + "bytes pushed" );
+    expect( reassembler.bytes_pending() == pending, description + "bytes pending" );
+    expect( reassembler.buffered_end_index() == max( highest, assembled ), description + "buffered end index" );
+
+    // (counting the holes means going over the whole window, so it's only done every few rounds.)
+    if ( ++rounds % 8 == 0 ) {
+      uint64_t holes = 0;
+      for ( uint64_t i = assembled + 1; i < min( window_end + 1, static_cast<uint64_t>( data.size() ) ); i++ ) {
+        holes += arrived[i] and not arrived[i - 1];
+      }
+      expect( reassembler.hole_count() == holes, description + "hole count" );
+    }
+
+    // read some of it.
+    const uint64_t already_read = output.size();
+    const uint64_t target = already_read + uniform_int_distribution<uint64_t> { 0, capacity }( rd );
+    while ( reassembler.reader().bytes_buffered() and output.size() < target ) {
+      const auto peeked = reassembler.reader().peek().substr( 0, target - output.size() );
+      output += peeked;
+      reassembler.reader().pop( peeked.size() );
+    }
+    const uint64_t just_read = output.size() - already_read;
+    expect( string_view( output ).substr( already_read ) == string_view( data ).substr( already_read, just_read ),
+            description + "bytes read" );
+  }
+
+  expect( output == data, description + "whole stream" );
+}
+
+int main()
+{
+  try {
+    for ( const auto storage :
+          { ByteStream::Storage::Chunked, ByteStream::Storage::Ring, ByteStream::Storage::Mapped } ) {
+      for ( size_t seed = 0; seed < 4; seed++ ) {
+        random_segments( storage, 1000 + 1500 * seed, seed, 1 );
+        random_segments( storage, 1000 + 1500 * seed, seed, 2 + seed * 5 );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
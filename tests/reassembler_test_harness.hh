@@ -49,6 +49,20 @@ struct BytesPending : public ConstExpectNumber<Reassembler, uint64_t>
   uint64_t value( const Reassembler& r ) const override { return r.bytes_pending(); }
 };
 
+struct HoleCount : public ConstExpectNumber<Reassembler, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "hole_count"; }
+  uint64_t value( const Reassembler& r ) const override { return r.hole_count(); }
+};
+
+struct BufferedEndIndex : public ConstExpectNumber<Reassembler, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "buffered_end_index"; }
+  uint64_t value( const Reassembler& r ) const override { return r.buffered_end_index(); }
+};
+
 struct Insert : public Action<Reassembler>
 {
   std::string data_;
@@ -0,0 +1,310 @@
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Reassembler throughput under several kinds of hostile or unlucky traffic, each one generated from a
+ * fixed seed, and run over both a Chunked stream (where the Reassembler keeps pieces) and a Ring stream
+ * (where it reassembles in place), inserting the segments one by one and then in batches of 32 (as a
+ * receiver that reads many datagrams per system call would). For each run, it reports:
+ *   - the throughput, in MB/s;
+ *   - the peak of bytes_pending(), sampled after every insert;
+ *   - the number of heap allocations, in all and per insert.
+ *
+ * The results are printed as JSON (to the file named by the first argument, if any, or to stdout), one
+ * object per run, so that different Reassembler designs can be compared by a script.
+ */
+
+// Count every heap allocation made by this program.
+namespace {
+uint64_t allocation_count = 0; // NOLINT(*-avoid-non-const-global-variables)
+}
+
+void* operator new( size_t size )
+{
+  allocation_count++;
+  void* ptr = malloc( size ); // NOLINT(*-no-malloc, *-owning-memory)
+  if ( ptr == nullptr ) {
+    throw bad_alloc {};
+  }
+  return ptr;
+}
+
+void* operator new[]( size_t size )
+{
+  return operator new( size );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete[]( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete[]( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+static constexpr uint64_t capacity = 1 << 20;
+static constexpr size_t segment_size = 1000;
+
+using Segments = vector<pair<uint64_t, size_t>>; // first index and length of each segment, in arrival order
+
+// The segments of [begin, end), `size` bytes each (the last one maybe shorter), in order.
+Segments in_order( uint64_t begin, uint64_t end, size_t size )
+{
+  Segments segments;
+  for ( uint64_t i = begin; i < end; i += size ) {
+    segments.emplace_back( i, min<uint64_t>( size, end - i ) );
+  }
+  return segments;
+}
+
+// Each window's segments arrive in a random order.
+Segments random_permutation( uint64_t length, default_random_engine& rd )
+{
+  Segments segments;
+  for ( uint64_t window = 0; window < length; window += capacity ) {
+    Segments shuffled = in_order( window, min( window + capacity, length ), segment_size );
+    shuffle( shuffled.begin(), shuffled.end(), rd );
+    segments.insert( segments.end(), shuffled.begin(), shuffled.end() );
+  }
+  return segments;
+}
+
+// Each segment arrives one to four times, and the copies are shuffled within the window.
+Segments heavy_duplication( uint64_t length, default_random_engine& rd )
+{
+  Segments segments;
+  uniform_int_distribution<size_t> copies { 1, 4 };
+  for ( uint64_t window = 0; window < length; window += capacity ) {
+    Segments shuffled;
+    for ( const auto& segment : in_order( window, min( window + capacity, length ), segment_size ) ) {
+      shuffled.insert( shuffled.end(), copies( rd ), segment );
+    }
+    shuffle( shuffled.begin(), shuffled.end(), rd );
+    segments.insert( segments.end(), shuffled.begin(), shuffled.end() );
+  }
+  return segments;
+}
+
+// 1-byte segments, shuffled within each run of 64.
+Segments tiny_segments( uint64_t length, default_random_engine& rd )
+{
+  Segments segments = in_order( 0, length, 1 );
+  for ( size_t i = 0; i < segments.size(); i += 64 ) {
+    shuffle( segments.begin() + static_cast<ptrdiff_t>( i ),
+             segments.begin() + static_cast<ptrdiff_t>( min( i + 64, segments.size() ) ),
+             rd );
+  }
+  return segments;
+}
+
+// Each window's segments arrive last first.
+Segments reverse_order( uint64_t length, default_random_engine& /* rd */ )
+{
+  Segments segments;
+  for ( uint64_t window = 0; window < length; window += capacity ) {
+    Segments reversed = in_order( window, min( window + capacity, length ), segment_size );
+    reverse( reversed.begin(), reversed.end() );
+    segments.insert( segments.end(), reversed.begin(), reversed.end() );
+  }
+  return segments;
+}
+
+// In order, except that in each window a burst of up to a tenth of the segments is lost, and sent
+// again (overlapping the segments around it) once the rest of the window has arrived.
+Segments burst_loss( uint64_t length, default_random_engine& rd )
+{
+  Segments segments;
+  for ( uint64_t window = 0; window < length; window += capacity ) {
+    const Segments window_segments = in_order( window, min( window + capacity, length ), segment_size );
+    const size_t burst = uniform_int_distribution<size_t> { 1, window_segments.size() / 10 + 1 }( rd );
+    const size_t lost = uniform_int_distribution<size_t> { 0, window_segments.size() - burst }( rd );
+    for ( size_t i = 0; i < window_segments.size(); i++ ) {
+      if ( i < lost or i >= lost + burst ) {
+        segments.push_back( window_segments[i] );
+      }
+    }
+    const uint64_t begin = window_segments[lost].first;
+    const uint64_t end = window_segments[lost + burst - 1].first + window_segments[lost + burst - 1].second;
+    for ( const auto& [first, len] : in_order( begin, end, segment_size ) ) {
+      const uint64_t start = first - min<uint64_t>( first, segment_size / 10 );
+      segments.emplace_back( start, min( length, first + len + segment_size / 10 ) - start );
+    }
+  }
+  return segments;
+}
+
+struct Workload
+{
+  string name;
+  uint64_t length;
+  function<Segments( uint64_t, default_random_engine& )> generate;
+};
+
+struct Result
+{
+  double megabytes_per_second {};
+  uint64_t peak_bytes_pending {};
+  uint64_t allocations {};
+  uint64_t inserts {};
+};
+
+Result run( ByteStream::Storage storage,
+            const string& data,
+            const Segments& segments,
+            size_t batch,
+            string& output )
+{
+  // the segments' strings are made before the clock starts, as if they had just arrived.
+  vector<Reassembler::Segment> payloads;
+  payloads.reserve( segments.size() );
+  for ( const auto& [first, len] : segments ) {
+    payloads.push_back( { first, data.substr( first, len ), first + len == data.size() } );
+  }
+
+  Reassembler reassembler { ByteStream { capacity, storage } };
+  output.clear();
+  Result result;
+  result.inserts = segments.size();
+
+  const uint64_t allocations_before = allocation_count;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < payloads.size(); ) {
+    // a batch only holds what the receiver's window would let in before the batch is read.
+    const uint64_t window_end = reassembler.reader().bytes_popped() + capacity;
+    size_t n = 1;
+    while ( n < batch and i + n < payloads.size()
+            and payloads[i + n].first_index + payloads[i + n].data.size() <= window_end ) {
+      n++;
+    }
+    if ( batch == 1 ) {
+      auto& segment = payloads[i];
+      reassembler.insert( segment.first_index, move( segment.data ), segment.is_last_substring );
+    } else {
+      reassembler.insert_batch( span( payloads ).subspan( i, n ) );
+    }
+    i += n;
+    result.peak_bytes_pending = max( result.peak_bytes_pending, reassembler.bytes_pending() );
+
+    while ( reassembler.reader().bytes_buffered() ) {
+      output += reassembler.reader().peek();
+      reassembler.reader().pop( output.size() - reassembler.reader().bytes_popped() );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  result.allocations = allocation_count - allocations_before;
+
+  if ( not reassembler.reader().is_finished() or output != data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  result.megabytes_per_second
+    = static_cast<double>( data.size() ) / duration<double>( stop_time - start_time ).count() / 1e6;
+  return result;
+}
+
+void program_body( ostream& json )
+{
+  const string data = [] {
+    default_random_engine rd { 1372 };
+    uniform_int_distribution<char> ud;
+    string ret( 8 * capacity, 0 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+
+  const vector<Workload> workloads {
+    { "random_permutation", data.size(), random_permutation },
+    { "heavy_duplication", data.size(), heavy_duplication },
+    { "tiny_segments", data.size() / 16, tiny_segments },
+    { "reverse_order", data.size(), reverse_order },
+    { "burst_loss", data.size(), burst_loss },
+  };
+
+  string output;
+  output.reserve( data.size() );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  double slowest = 1e9;
+  json << "[\n";
+  for ( size_t i = 0; i < workloads.size(); i++ ) {
+    const Workload& workload = workloads[i];
+    default_random_engine rd { 1373 + i };
+    const string workload_data = data.substr( 0, workload.length );
+    const Segments segments = workload.generate( workload_data.size(), rd );
+
+    for ( const auto storage : { ByteStream::Storage::Chunked, ByteStream::Storage::Ring } ) {
+      for ( const size_t batch : { 1UL, 32UL } ) {
+        const Result result = run( storage, workload_data, segments, batch, output );
+        slowest = min( slowest, result.megabytes_per_second );
+        const string storage_name = storage == ByteStream::Storage::Chunked ? "chunked" : "ring";
+        const bool last = i + 1 == workloads.size() and storage == ByteStream::Storage::Ring and batch > 1;
+
+        json << "  { \"workload\": \"" << workload.name << "\", \"storage\": \"" << storage_name
+             << "\", \"batch\": " << batch << ", \"bytes\": " << workload_data.size()
+             << ", \"inserts\": " << result.inserts << ", \"mb_per_s\": " << fixed << setprecision( 1 )
+             << result.megabytes_per_second << ", \"peak_bytes_pending\": " << result.peak_bytes_pending
+             << ", \"allocations\": " << result.allocations << ", \"allocations_per_insert\": " << setprecision( 4 )
+             << static_cast<double>( result.allocations ) / static_cast<double>( result.inserts ) << " }"
+             << ( last ? "" : "," ) << "\n";
+
+        debug_output << "             Reassembler " << workload.name << " (" << storage_name << ", batch "
+                     << batch << "): " << fixed << setprecision( 1 ) << result.megabytes_per_second << " MB/s\n";
+      }
+    }
+  }
+  json << "]\n";
+
+  if ( slowest < 1 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 1 MB/s in every workload." );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc > 1 ) {
+      ofstream json { argv[1] }; // NOLINT(*-pointer-arithmetic)
+      program_body( json );
+    } else {
+      program_body( cout );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -111,6 +112,34 @@ struct ExpectAcknoBetween : public Expectation<TCPReceiver>
   }
 };
 
+struct ExpectSack : public Expectation<TCPReceiver>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> sack_;
+  explicit ExpectSack( std::vector<std::pair<Wrap32, Wrap32>> sack ) : sack_( std::move( sack ) ) {}
+
+  static std::string str( const std::vector<std::pair<Wrap32, Wrap32>>& sack )
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for ( const auto& [left, right] : sack ) {
+      ss << " [" << left << ", " << right << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override { return "SACK blocks = " + str( sack_ ); }
+
+  void execute( TCPReceiver& rs ) const override
+  {
+    const auto sack = rs.send().sack;
+    if ( sack != sack_ ) {
+      throw ExpectationViolation( "The TCPReceiver should have sent SACK blocks " + str( sack_ )
+                                  + ", but instead it was " + str( sack ) + "." );
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<TCPReceiver>
 {
   using ExpectBool::ExpectBool;
@@ -0,0 +1,105 @@
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// Send `data` from one TCPPeer to another over a link that drops `loss_percent` of the messages, and delays
+// each of the others by 1 to 8 ms (so they arrive out of order). Returns how many bytes the receiver dropped
+// to stay within its budget.
+uint64_t transfer( const TCPConfig& cfg, const string& data, unsigned loss_percent, default_random_engine& rd )
+{
+  TCPPeer sender { cfg };
+  TCPPeer receiver { cfg };
+  uint64_t now = 0;
+  multimap<uint64_t, TCPMessage> to_sender;
+  multimap<uint64_t, TCPMessage> to_receiver;
+  const auto link = [&]( multimap<uint64_t, TCPMessage>& queue ) {
+    return [&]( TCPMessage message ) {
+      if ( uniform_int_distribution<unsigned> { 0, 99 }( rd ) >= loss_percent ) {
+        queue.emplace( now + uniform_int_distribution<uint64_t> { 1, 8 }( rd ), move( message ) );
+      }
+    };
+  };
+  const auto deliver = [&]( multimap<uint64_t, TCPMessage>& queue, TCPPeer& peer, auto&& reply ) {
+    while ( not queue.empty() and queue.begin()->first <= now ) {
+      TCPMessage message = move( queue.begin()->second );
+      queue.erase( queue.begin() );
+      peer.receive( move( message ), reply );
+    }
+  };
+
+  sender.outbound_writer().push( data );
+  sender.outbound_writer().close();
+  sender.push( link( to_receiver ) );
+
+  const Reassembler& reassembler = receiver.receiver().reassembler();
+  string output;
+  for ( ; now < 600'000 and not receiver.inbound_reader().is_finished(); now++ ) {
+    deliver( to_receiver, receiver, link( to_sender ) );
+    expect( reassembler.bytes_pending() <= cfg.reassembly_limit, "within the budget" );
+    deliver( to_sender, sender, link( to_receiver ) );
+    while ( receiver.inbound_reader().bytes_buffered() ) {
+      output += receiver.inbound_reader().peek();
+      receiver.inbound_reader().pop( output.size() - receiver.inbound_reader().bytes_popped() );
+    }
+    sender.tick( 1, link( to_receiver ) );
+    receiver.tick( 1, link( to_sender ) );
+  }
+
+  expect( receiver.inbound_reader().is_finished(), "transfer finished" );
+  expect( output == data, "data received intact" );
+  return reassembler.bytes_evicted();
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    const string data = [&] {
+      string ret( 200'000, 0 );
+      for ( auto& c : ret ) {
+        c = static_cast<char>( uniform_int_distribution<int> { 'a', 'z' }( rd ) );
+      }
+      return ret;
+    }();
+
+    // with a budget of three segments for the out-of-order bytes, every transfer still gets through (the
+    // bytes dropped are sent again, like lost ones), whether they are evicted or refused.
+    for ( const bool in_place : { false, true } ) {
+      for ( const auto algorithm : { CongestionControl::Algorithm::None, CongestionControl::Algorithm::NewReno } ) {
+        for ( const unsigned loss_percent : { 0, 2, 10 } ) {
+          TCPConfig cfg;
+          cfg.send_capacity = data.size();
+          cfg.rt_timeout = 50;
+          cfg.reassembly_limit = 3000;
+          cfg.reassemble_in_place = in_place;
+          cfg.congestion_control = algorithm;
+          expect( transfer( cfg, data, loss_percent, rd ) > 0, "the budget was reached" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
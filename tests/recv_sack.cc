@@ -0,0 +1,116 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "SACK blocks, most recent first", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectSack { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "klmn" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 15 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 21 ).with_data( "uv" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 15 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 15 ).with_data( "op" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 17 } },
+                                   { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcdefghij" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 17 } } );
+      test.execute( ExpectSack { { { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 17 ).with_data( "qrst" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 23 } } );
+      test.execute( ExpectSack { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "at most four SACK blocks", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      for ( uint32_t i = 1; i <= 6; i++ ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 + 10 * i ).with_data( "x" ) );
+      }
+      test.execute( ExpectSack { { { Wrap32 { isn + 61 }, Wrap32 { isn + 62 } },
+                                   { Wrap32 { isn + 51 }, Wrap32 { isn + 52 } },
+                                   { Wrap32 { isn + 41 }, Wrap32 { isn + 42 } },
+                                   { Wrap32 { isn + 31 }, Wrap32 { isn + 32 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "xy" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 13 } },
+                                   { Wrap32 { isn + 61 }, Wrap32 { isn + 62 } },
+                                   { Wrap32 { isn + 51 }, Wrap32 { isn + 52 } },
+                                   { Wrap32 { isn + 41 }, Wrap32 { isn + 42 } } } } );
+    }
+
+    {
+      // the blocks survive the trip through a TCP segment's options.
+      const Wrap32 isn { uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd ) };
+      TCPReceiver receiver { Reassembler { ByteStream { 4000 } } };
+      receiver.receive( { isn, true, {}, false, false } );
+      receiver.receive( { isn + 101, false, "hello", false, false } );
+      receiver.receive( { isn + 201, false, "world", false, false } );
+
+      TCPSegment segment;
+      segment.message.sender = { isn + 7, true, "payload", false, false };
+      segment.message.receiver = receiver.send();
+      segment.message.receiver.SACK_permitted = true;
+      if ( segment.header_length() != 20 + 4 + 4 + 16 ) {
+        throw runtime_error( "unexpected header length " + to_string( segment.header_length() ) );
+      }
+      segment.compute_checksum( 0 );
+
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( segment ), 0 ) ) {
+        throw runtime_error( "segment with options didn't parse" );
+      }
+      if ( parsed.message.receiver.sack != segment.message.receiver.sack or not parsed.message.sender.SYN
+           or parsed.message.sender.payload != "payload" or parsed.message.receiver.ackno != Wrap32 { isn + 1 }
+           or not parsed.message.receiver.SACK_permitted ) {
+        throw runtime_error( "segment with options didn't survive the round trip" );
+      }
+    }
+
+    {
+      // the options fit in 40 bytes: after all of a SYN's, there's only room for three SACK blocks.
+      const Wrap32 isn { uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd ) };
+      TCPSegment segment;
+      segment.message.sender = { isn, true, {}, false, false };
+      segment.message.receiver.ackno = isn + 1;
+      segment.message.receiver.MSS = 1460;
+      segment.message.receiver.window_scale = 7;
+      segment.message.receiver.SACK_permitted = true;
+      for ( uint32_t i = 0; i < TCPConfig::MAX_SACK_BLOCKS; i++ ) {
+        segment.message.receiver.sack.emplace_back( isn + 101 + 100 * i, isn + 151 + 100 * i );
+      }
+      if ( segment.header_length() != 20 + 12 + 4 + 8 * 3 ) {
+        throw runtime_error( "unexpected header length " + to_string( segment.header_length() ) );
+      }
+      segment.compute_checksum( 0 );
+
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( segment ), 0 ) or parsed.message.receiver.sack.size() != 3
+           or parsed.message.receiver.sack[2] != segment.message.receiver.sack[2] ) {
+        throw runtime_error( "SYN with all the options didn't survive the round trip" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// A path whose bottleneck forwards one 1000-byte segment every 10 ms, with 50 ms of delay besides (so its
+// bandwidth-delay product is 6000 bytes), run for `ms` milliseconds with the window `cc` gives. Returns
+// the longest RTT of the last second.
+uint64_t run_path( CongestionControl& cc, uint64_t ms )
+{
+  struct Segment
+  {
+    uint64_t sent_at;
+    uint64_t delivered_at_send;
+    uint64_t ack_at;
+  };
+  deque<Segment> flight;
+  uint64_t delivered = 0;
+  uint64_t in_flight = 0;
+  uint64_t link_free_at = 0;
+  uint64_t longest_rtt = 0;
+
+  for ( uint64_t now = 0; now < ms; now++ ) {
+    while ( not flight.empty() and flight.front().ack_at <= now ) {
+      const Segment segment = flight.front();
+      flight.pop_front();
+      delivered += 1000;
+      in_flight -= 1000;
+      if ( now + 1000 >= ms ) {
+        longest_rtt = max( longest_rtt, now - segment.sent_at );
+      }
+      cc.on_ack( { .now_ms = now,
+                   .acked = 1000,
+                   .in_flight = in_flight,
+                   .delivered = delivered,
+                   .delivered_at_send = segment.delivered_at_send,
+                   .rtt_ms = now - segment.sent_at } );
+    }
+    while ( in_flight + 1000 <= cc.window() ) {
+      link_free_at = max( link_free_at, now ) + 10;
+      flight.push_back( { now, delivered, link_free_at + 50 } );
+      in_flight += 1000;
+    }
+  }
+  return longest_rtt;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without congestion control, only the receiver's window counts", cfg };
+      test.execute( ExpectCongestionWindow { UINT64_MAX } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 10000 ) );
+      test.execute( Push { string( 10000, 'x' ) } );
+      test.execute( ExpectSeqnosInFlight { 10000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "NewReno slow start, and a timeout", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 4000 } );
+      test.execute( Push { string( 20000, 'x' ) } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+
+      // one MSS more for an ACK, even of two segments.
+      test.execute( AckReceived { isn + 2001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 5000 } );
+      for ( uint32_t i = 4; i < 7; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+
+      // a timeout leaves one segment of window, and half the flight as the slow start threshold.
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectCongestionWindow { 1000 } );
+      test.execute( AckReceived { isn + 7001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectSeqnosInFlight { 2000 } );
+      test.execute( AckReceived { isn + 9001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 3000 } );
+
+      // past the threshold, one MSS more per window acknowledged.
+      test.execute( AckReceived { isn + 12001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 4000 } );
+      test.execute( AckReceived { isn + 14001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 4000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "NewReno halves the window once per window of losses", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).with_sack( isn + 1001, isn + 4001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).with_sack( isn + 1001, isn + 4001 ) );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      // CUBIC takes 30% off the window on a loss, and then grows back slowly near the window it had.
+      const auto cubic = CongestionControl::make( CongestionControl::Algorithm::Cubic, 1000 );
+      for ( uint64_t i = 0; i < 6; i++ ) {
+        cubic->on_ack( { .now_ms = 0, .acked = 1000, .delivered = 1000 * i + 1000, .rtt_ms = 1000 } );
+      }
+      expect( cubic->window() == 10000, "CUBIC slow start" );
+      cubic->on_loss( 0, 10000 );
+      expect( cubic->window() == 7000, "CUBIC reduction" );
+      uint64_t now = 0;
+      while ( now < 2000 ) {
+        now += 1000;
+        cubic->on_ack( { .now_ms = now, .acked = cubic->window(), .rtt_ms = 1000 } );
+      }
+      expect( cubic->window() > 9000 and cubic->window() < 11000, "CUBIC back near the window before the loss" );
+      cubic->on_timeout( now, cubic->window() );
+      expect( cubic->window() == 1000, "CUBIC timeout" );
+    }
+
+    {
+      // BBR settles on twice the bandwidth-delay product, with a short queue.
+      const auto bbr = CongestionControl::make( CongestionControl::Algorithm::BBR, 1000 );
+      const uint64_t longest_rtt = run_path( *bbr, 5000 );
+      expect( bbr->window() >= 9000 and bbr->window() <= 15000,
+              "BBR window of " + to_string( bbr->window() ) + " is about twice the BDP" );
+      expect( longest_rtt <= 150, "BBR longest RTT of " + to_string( longest_rtt ) + " ms" );
+      const double pacing_rate = bbr->pacing_rate().value_or( 0 );
+      expect( pacing_rate >= 70 and pacing_rate <= 130,
+              "BBR pacing rate of " + to_string( pacing_rate ) + " is about the bottleneck's 100 bytes/ms" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
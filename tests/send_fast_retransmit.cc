@@ -0,0 +1,124 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "Fast retransmit, and NewReno fast recovery through a partial ACK", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+
+      // two duplicate ACKs aren't enough...
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // ...but three are: the first message is sent again, the window is halved, and inflated by the three
+      // messages that have left the network, so one new message goes out too.
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 4001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 2000 } );
+
+      // each further duplicate lets one more out.
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // a partial ACK: the next message was lost too, and is sent again at once.
+      test.execute( AckReceived { isn + 1001 }.with_win( 60000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 6001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+
+      // a full ACK ends the recovery, with the halved window.
+      test.execute( AckReceived { isn + 7001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 7001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 8001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "ACKs that change the window aren't duplicates", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      for ( uint16_t i = 1; i <= 4; i++ ) {
+        test.execute( AckReceived { isn + 1 }.with_win( 60000 - i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 4000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "Duplicate ACKs after a timeout don't inflate the window", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+
+      // the third duplicate ACK sends the message again, but there's no recovery (the timeout reacted to the
+      // losses already), so no inflation.
+      for ( uint32_t i = 0; i < 3; i++ ) {
+        test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { isn + 4001 }.with_win( 60000 ) );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( Push { string( 10000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 4001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
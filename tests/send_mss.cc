@@ -0,0 +1,157 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      // the MSS goes in the options of a SYN only.
+      TCPSegment segment;
+      segment.message.sender = { Wrap32( rd() ), true, {}, false, false };
+      segment.message.receiver.MSS = 8960;
+      expect( segment.header_length() == 20 + 4, "header length of a SYN with an MSS" );
+      segment.compute_checksum( 0 );
+
+      TCPSegment parsed;
+      expect( parse( parsed, serialize( segment ), 0 ), "SYN with an MSS parses" );
+      expect( parsed.message.receiver.MSS == 8960, "MSS survives the round trip" );
+
+      segment.message.sender.SYN = false;
+      expect( segment.header_length() == 20, "no MSS without a SYN" );
+      segment.compute_checksum( 0 );
+      expect( parse( parsed, serialize( segment ), 0 ) and not parsed.message.receiver.MSS.has_value(),
+              "segment without a SYN parses, without an MSS" );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 9000;
+
+      TCPSenderTestHarness test { "Messages as large as the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 9000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 9000 ).with_seqno( isn + 9001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 2000 ).with_seqno( isn + 18001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 9000;
+
+      TCPSenderTestHarness test { "The receiver's MSS option lowers the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).with_mss( 1460 ) );
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ).with_seqno( isn + 1461 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 80 ).with_seqno( isn + 2921 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 9000;
+      cfg.mtu_probing = true;
+
+      TCPSenderTestHarness test { "Probes that get through raise the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+
+      // halfway between the 1000 bytes that get through and the 9000 that might.
+      test.execute( Push { string( 10000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 5000 ).with_seqno( isn + 1 ) );
+      for ( uint32_t i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 5001 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 10001 }.with_win( 60000 ) );
+
+      test.execute( Push { string( 17000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 7000 ).with_seqno( isn + 10001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 5000 ).with_seqno( isn + 17001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 5000 ).with_seqno( isn + 22001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 9000;
+      cfg.mtu_probing = true;
+
+      TCPSenderTestHarness test { "A lost probe is sent again in messages of the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+
+      // a probe, then three messages that the receiver SACKs, so the probe is lost. After three losses, the
+      // search goes on below that size.
+      uint32_t next = 1;
+      for ( const uint32_t probe : { 5000, 5000, 5000 } ) {
+        test.execute( Push { string( probe + 3000, 'x' ) } );
+        test.execute( ExpectMessage {}.with_payload_size( probe ).with_seqno( isn + next ) );
+        for ( uint32_t i = 0; i < 3; i++ ) {
+          test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + next + probe + 1000 * i ) );
+        }
+        test.execute(
+          AckReceived { isn + next }.with_win( 60000 ).with_sack( isn + next + probe, isn + next + probe + 3000 ) );
+        for ( uint32_t i = 0; i < probe / 1000; i++ ) {
+          test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + next + 1000 * i ) );
+        }
+        test.execute( ExpectNoSegment {} );
+        test.execute( AckReceived { isn + next + probe + 3000 }.with_win( 60000 ) );
+        next += probe + 3000;
+      }
+
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 3000 ).with_seqno( isn + next ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + next + 3000 ) );
+      test.execute( AckReceived { isn + next + 4000 }.with_win( 60000 ) );
+      next += 4000;
+
+      // the probe of 3000 got through, so the next one is halfway between it and 4999.
+      test.execute( Push { string( 10000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 4000 ).with_seqno( isn + next ) );
+      test.execute( ExpectMessage {}.with_payload_size( 3000 ).with_seqno( isn + next + 4000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 3000 ).with_seqno( isn + next + 7000 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+      cfg.pacing = true;
+
+      TCPSenderTestHarness test { "Pacing at twice the window per RTT", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Tick { 1 } );
+
+      // a window of 4000 and an RTT of 10 ms: 800 bytes per millisecond, so 1.25 ms between messages. The
+      // first goes at once, and the others are due at 11.25, 12.5 and 13.75 ms (counting from the tick at
+      // 10 ms), so they go at the ticks after.
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 3001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+      cfg.pacing = true;
+
+      TCPSenderTestHarness test { "A long tick lets the messages that were due in it catch up", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Tick { 1 } );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 4 } );
+      for ( uint32_t i = 1; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "Without pacing, the window goes out at once", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectSeqnosInFlight { 4000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_min_ms = 10;
+      cfg.rto_max_ms = 100;
+
+      TCPSenderTestHarness test { "Adaptive RTO follows the RTT, and Karn's rule", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( ExpectSmoothedRTT { nullopt } );
+
+      // the first sample: SRTT = 5, RTTVAR = 2.5, so RTO = 5 + 4 * 2.5.
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSmoothedRTT { 5 } );
+      test.execute( ExpectRTO { 15 } );
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( Tick { 14 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectRTO { 30 } );
+
+      // the ACK of a retransmitted message gives no sample, so the backed-off RTO stays.
+      test.execute( Tick { 2 } );
+      test.execute( AckReceived { isn + 4 } );
+      test.execute( ExpectSmoothedRTT { 5 } );
+      test.execute( ExpectRTO { 30 } );
+
+      // backoff stops at the highest RTO.
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 29 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 60 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO { 100 } );
+      test.execute( Tick { 100 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO { 100 } );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectRTO { 100 } );
+
+      // a new sample: RTTVAR = 3/4 * 2.5 + 1/4 * 2, SRTT = 7/8 * 5 + 1/8 * 7, so RTO = 5.25 + 9.5, rounded up.
+      test.execute( Push { "ghi" } );
+      test.execute( ExpectMessage {}.with_data( "ghi" ) );
+      test.execute( Tick { 7 } );
+      test.execute( AckReceived { isn + 10 } );
+      test.execute( ExpectSmoothedRTT { 5 } );
+      test.execute( ExpectRTO { 15 } );
+
+      // and the lowest RTO holds however short the RTT gets.
+      for ( uint32_t i = 0; i < 20; i++ ) {
+        test.execute( Push { "x" } );
+        test.execute( ExpectMessage {}.with_data( "x" ) );
+        test.execute( AckReceived { isn + 11 + i } );
+      }
+      test.execute( ExpectSmoothedRTT { 0 } );
+      test.execute( ExpectRTO { 10 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without adaptive RTO, a new ACK brings back the initial RTO", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSmoothedRTT { 5 } );
+      test.execute( ExpectRTO { cfg.rt_timeout } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Segment with three SACKed after it is sent again once", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      for ( uint32_t i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ).with_sack( isn + 1001, isn + 3001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ).with_sack( isn + 1001, isn + 4001 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 5000 } );
+
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ).with_sack( isn + 1001, isn + 4001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 4001 }.with_win( 6000 ) );
+      test.execute( ExpectSeqnosInFlight { 1000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "SACKed segments don't count as new data acknowledged", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ) );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( Tick { cfg.rt_timeout - 1U } );
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ).with_sack( isn + 1001, isn + 2001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectConsecutiveRetransmissions { 1 } );
+      test.execute( ExpectSeqnosInFlight { 2000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "After a timeout, the segment at the ackno is sent again, SACKed or not", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      for ( uint32_t i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( AckReceived { isn + 1 }.with_win( 6000 ).with_sack( isn + 1001, isn + 4001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the receiver drops the data it SACKed, and only ever acknowledges the first segment.
+      test.execute( AckReceived { isn + 1001 }.with_win( 6000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 2U * cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectConsecutiveRetransmissions { 2 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
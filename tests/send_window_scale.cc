@@ -0,0 +1,154 @@
+#include "checksum.hh"
+#include "random.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Expectation failed: " + what );
+  }
+}
+
+// Send `data` from one TCPPeer to another, with every message going through a TCP segment's header and
+// options, and one millisecond of delay each way. Returns the most sequence numbers that were in flight.
+uint64_t transfer( const TCPConfig& cfg, const string& data )
+{
+  TCPPeer sender { cfg };
+  TCPPeer receiver { cfg };
+  deque<TCPMessage> to_sender;
+  deque<TCPMessage> to_receiver;
+  const auto wire = []( deque<TCPMessage>& queue ) {
+    return [&queue]( const TCPMessage& message ) {
+      TCPSegment segment { .message = message };
+      segment.compute_checksum( 0 );
+      TCPSegment parsed;
+      expect( parse( parsed, serialize( segment ), 0 ), "segment parses" );
+      queue.push_back( parsed.message );
+    };
+  };
+
+  sender.outbound_writer().push( data );
+  sender.outbound_writer().close();
+  sender.push( wire( to_receiver ) );
+
+  string output;
+  uint64_t most_in_flight = 0;
+  for ( unsigned ms = 0; ms < 1000 and output.size() < data.size(); ms++ ) {
+    for ( auto queue = move( to_receiver ); not queue.empty(); queue.pop_front() ) {
+      receiver.receive( move( queue.front() ), wire( to_sender ) );
+    }
+    while ( receiver.inbound_reader().bytes_buffered() ) {
+      output += receiver.inbound_reader().peek();
+      receiver.inbound_reader().pop( output.size() - receiver.inbound_reader().bytes_popped() );
+    }
+    for ( auto queue = move( to_sender ); not queue.empty(); queue.pop_front() ) {
+      sender.receive( move( queue.front() ), wire( to_receiver ) );
+    }
+    most_in_flight = max( most_in_flight, sender.sender().sequence_numbers_in_flight() );
+    sender.tick( 1, wire( to_receiver ) );
+    receiver.tick( 1, wire( to_sender ) );
+  }
+
+  expect( output == data, "data received intact" );
+  return most_in_flight;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      // the window scale goes in the options of a SYN only.
+      TCPSegment segment;
+      segment.message.sender = { Wrap32( rd() ), true, {}, false, false };
+      segment.message.receiver.window_scale = 7;
+      expect( segment.header_length() == 20 + 4, "header length of a SYN with a window scale" );
+      segment.message.receiver.MSS = 1460;
+      expect( segment.header_length() == 20 + 4 + 4, "header length of a SYN with an MSS too" );
+      segment.compute_checksum( 0 );
+
+      TCPSegment parsed;
+      expect( parse( parsed, serialize( segment ), 0 ), "SYN with a window scale parses" );
+      expect( parsed.message.receiver.window_scale == 7 and parsed.message.receiver.MSS == 1460,
+              "window scale survives the round trip" );
+
+      // on a segment without a SYN, the SYN's options are ignored.
+      string bytes;
+      for ( const auto& buffer : serialize( segment ) ) {
+        bytes += buffer;
+      }
+      bytes[13] = static_cast<char>( bytes[13] & ~0b0000'0010 ); // no SYN flag
+      bytes[16] = bytes[17] = 0;
+      InternetChecksum check;
+      check.add( bytes );
+      bytes[16] = static_cast<char>( check.value() >> 8 );
+      bytes[17] = static_cast<char>( check.value() & 0xFF );
+      expect( parse( parsed, { bytes }, 0 ) and not parsed.message.sender.SYN, "segment without a SYN parses" );
+      expect( not parsed.message.receiver.window_scale.has_value() and not parsed.message.receiver.MSS.has_value(),
+              "no window scale or MSS without a SYN" );
+    }
+
+    {
+      // a SYN sent again after the window scaling started still has an unscaled window.
+      TCPConfig cfg;
+      cfg.recv_capacity = 4 << 20;
+      cfg.window_scaling = true;
+      TCPPeer active { cfg };
+      TCPPeer passive { cfg };
+      vector<TCPMessage> sent;
+      const auto keep = [&sent]( TCPMessage message ) { sent.push_back( move( message ) ); };
+
+      active.push( keep );
+      expect( sent.size() == 1 and sent[0].sender.SYN and sent[0].receiver.window_scale == 7, "SYN" );
+      passive.receive( sent[0], keep );
+      passive.tick( cfg.rt_timeout, keep );
+      expect( sent.size() == 3 and sent[1].sender.SYN and sent[2].sender.SYN, "SYN-ACK, sent twice" );
+      expect( sent[1].receiver.window_size == UINT16_MAX and sent[2].receiver.window_size == UINT16_MAX,
+              "unscaled windows on the SYN-ACKs" );
+    }
+
+    {
+      // a scaled window can be as large as the capacity (rounded down to the unit).
+      TCPReceiver receiver { Reassembler { ByteStream { 1 << 20 } } };
+      expect( receiver.send().window_size == UINT16_MAX, "unscaled window" );
+      receiver.set_window_scale( 5 );
+      expect( receiver.send().window_size == ( 1 << 20 ) >> 5, "scaled window" );
+      receiver.receive( { Wrap32( rd() ), true, string( 100, 'x' ), false, false } );
+      expect( receiver.send().window_size == ( ( 1 << 20 ) - 100 ) >> 5, "scaled window, rounded down" );
+    }
+
+    {
+      // with the whole stream in the buffers, only the receiver's window limits the flight.
+      const string data( 2 << 20, 'x' );
+      TCPConfig cfg;
+      cfg.send_capacity = cfg.recv_capacity = 4 << 20;
+
+      const uint64_t unscaled = transfer( cfg, data );
+      expect( unscaled <= UINT16_MAX, "64 kB in flight without window scaling" );
+
+      cfg.window_scaling = true;
+      const uint64_t scaled = transfer( cfg, data );
+      expect( scaled > 1 << 20, "over a megabyte in flight with window scaling" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
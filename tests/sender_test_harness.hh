@@ -80,6 +80,27 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<SenderAndOutput, u
   uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.consecutive_retransmissions(); }
 };
 
+struct ExpectCongestionWindow : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.congestion_window(); }
+};
+
+struct ExpectRTO : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.current_RTO_ms(); }
+};
+
+struct ExpectSmoothedRTT : public ExpectNumber<SenderAndOutput, std::optional<uint64_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "smoothed_RTT_ms"; }
+  std::optional<uint64_t> value( SenderAndOutput& ss ) const override { return ss.sender.smoothed_RTT_ms(); }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -192,7 +213,14 @@ struct Receive : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& [left, right] : msg_.sack ) {
+      desc << ", sack=[" << left << ", " << right << ")";
+    }
+    if ( msg_.MSS.has_value() ) {
+      desc << ", mss=" << msg_.MSS.value();
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push stream to TCPSender";
     }
@@ -205,6 +233,18 @@ struct Receive : public Action<SenderAndOutput>
     return *this;
   }
 
+  Receive& with_sack( Wrap32 left, Wrap32 right )
+  {
+    msg_.sack.emplace_back( left, right );
+    return *this;
+  }
+
+  Receive& with_mss( uint16_t mss )
+  {
+    msg_.MSS = mss;
+    return *this;
+  }
+
   void execute( SenderAndOutput& ss ) const override
   {
     ss.sender.receive( msg_ );
@@ -340,7 +380,7 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( payload_size.has_value() and seg.payload.size() != payload_size.value() ) {
       throw ExpectationViolation( "payload_size", payload_size.value(), seg.payload.size() );
     }
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.sender.max_MSS() ) {
       throw ExpectationViolation( "payload has length (" + std::to_string( seg.payload.size() )
                                   + ") greater than the maximum" );
     }
@@ -359,6 +399,23 @@ public:
   TCPSenderTestHarness( std::string name, TCPConfig config )
     : TestHarness( move( name ),
                    "initial_RTO_ms=" + to_string( config.rt_timeout ),
-                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+                   { make_sender( config ) } )
   {}
+
+private:
+  static TCPSender make_sender( const TCPConfig& config )
+  {
+    TCPSender sender {
+      ByteStream { config.send_capacity }, config.isn, config.rt_timeout, config.congestion_control };
+    if ( config.adaptive_rto ) {
+      sender.set_adaptive_RTO( config.rto_min_ms, config.rto_max_ms );
+    }
+    sender.set_pacing( config.pacing );
+    if ( config.mtu_probing ) {
+      sender.set_path_MTU_discovery( config.mss );
+    } else {
+      sender.set_MSS( config.mss );
+    }
+    return sender;
+  }
 };
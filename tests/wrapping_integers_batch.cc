@@ -0,0 +1,72 @@
+#include "random.hh"
+#include "test_should_be.hh"
+#include "wrapping_integers.hh"
+
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// wrap and unwrap are constexpr.
+static_assert( Wrap32::wrap( 3UL << 32 | 5, Wrap32 { 10 } ) == Wrap32 { 15 } );
+static_assert( Wrap32 { 15 }.unwrap( Wrap32 { 10 }, 3UL << 32 ) == ( 3UL << 32 | 5 ) );
+static_assert( Wrap32 { UINT32_MAX }.unwrap( Wrap32 { 0 }, 0 ) == UINT32_MAX );
+static_assert( Wrap32 { 5 }.unwrap( Wrap32 { 0 }, ( 1UL << 63 ) + 10 ) == ( 1UL << 63 ) + 5 );
+static_assert( Wrap32 { 5 }.unwrap( Wrap32 { 0 }, UINT64_MAX - 5 ) == ( UINT64_MAX << 32 | 5 ) );
+
+// The candidate closest to the checkpoint, found the slow way (the lower one, if two are as close).
+uint64_t closest( uint32_t offset, uint64_t checkpoint )
+{
+  const auto distance = [checkpoint]( uint64_t n ) { return n > checkpoint ? n - checkpoint : checkpoint - n; };
+  const uint64_t middle = ( checkpoint & ( UINT64_MAX << 32 ) ) | offset;
+  uint64_t best = middle;
+  if ( middle >= 1UL << 32 and distance( middle - ( 1UL << 32 ) ) <= distance( best ) ) {
+    best = middle - ( 1UL << 32 );
+  }
+  if ( middle < UINT64_MAX << 32 and distance( middle + ( 1UL << 32 ) ) < distance( best ) ) {
+    best = middle + ( 1UL << 32 );
+  }
+  return best;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    uniform_int_distribution<uint32_t> dist32;
+    uniform_int_distribution<uint64_t> dist63 { 0, uint64_t { 1 } << 63 };
+    uniform_int_distribution<uint64_t> dist64;
+
+    // unwrap_many gives the same answers as unwrap, for any length (so the tail past the last full vector
+    // is covered too), near the checkpoint and far from it.
+    for ( size_t length = 0; length < 40; length++ ) {
+      for ( int round = 0; round < 100; round++ ) {
+        const Wrap32 zero_point { dist32( rd ) };
+        const uint64_t checkpoint = round % 4 == 3 ? dist64( rd ) | 1UL << 63 // top half, where the sign bit is set
+                                    : round % 4 == 1 ? dist63( rd )
+                                    : round % 4 == 2 ? UINT64_MAX - dist32( rd ) % 100
+                                                     : dist32( rd ) % 100;
+        vector<Wrap32> seqnos;
+        for ( size_t i = 0; i < length; i++ ) {
+          seqnos.push_back( round % 3 ? Wrap32 { dist32( rd ) } : Wrap32::wrap( checkpoint + i, zero_point ) );
+        }
+
+        vector<uint64_t> out( length );
+        Wrap32::unwrap_many( seqnos, zero_point, checkpoint, out );
+        for ( size_t i = 0; i < length; i++ ) {
+          test_should_be( out[i], seqnos[i].unwrap( zero_point, checkpoint ) );
+          const uint32_t offset = bit_cast<uint32_t>( seqnos[i] ) - bit_cast<uint32_t>( zero_point );
+          test_should_be( out[i], closest( offset, checkpoint ) );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,11 +6,19 @@
 #include <exception>
 #include <iostream>
 #include <optional>
+#include <random>
 #include <stdexcept>
 #include <string>
 
 using namespace std;
 
+// Serial number arithmetic is constexpr, and goes the short way around the circle.
+static_assert( Wrap32 { 5 } - Wrap32 { UINT32_MAX } == 6 );
+static_assert( Wrap32 { UINT32_MAX } - Wrap32 { 5 } == -6 );
+static_assert( Wrap32 { UINT32_MAX } < Wrap32 { 5 } );
+static_assert( Wrap32 { 5 } <= Wrap32 { 5 } and not( Wrap32 { 5 } < Wrap32 { 5 } ) );
+static_assert( Wrap32 { 0 } + ( ( 1U << 31 ) - 1 ) > Wrap32 { 0 } );
+
 int main()
 {
   try {
@@ -28,6 +36,22 @@ int main()
       const uint32_t m = n + diff;
       test_should_be( Wrap32( n ) == Wrap32( m ), n == m );
       test_should_be( Wrap32( n ) != Wrap32( m ), n != m );
+      test_should_be( Wrap32( m ) - Wrap32( n ), static_cast<int32_t>( diff ) );
+      test_should_be( Wrap32( n ) < Wrap32( m ), diff > 0 );
+      test_should_be( Wrap32( n ) <= Wrap32( m ), true );
+      test_should_be( Wrap32( m ) > Wrap32( n ), diff > 0 );
+      test_should_be( Wrap32( m ) <= Wrap32( n ), diff == 0 );
+    }
+
+    // Comparing seqnos agrees with comparing the absolute seqnos they unwrap to, within 2^31 of each other.
+    for ( size_t i = 0; i < N_REPS; i++ ) {
+      const Wrap32 zero_point { static_cast<uint32_t>( rd() ) };
+      const uint64_t a = ( static_cast<uint64_t>( rd() ) << 8 ) + ( uint64_t { 1 } << 31 );
+      const int32_t distance = uniform_int_distribution<int32_t> { INT32_MIN + 1, INT32_MAX }( rd );
+      const uint64_t b = a + static_cast<uint64_t>( static_cast<int64_t>( distance ) );
+      test_should_be( Wrap32::wrap( a, zero_point ) < Wrap32::wrap( b, zero_point ), a < b );
+      test_should_be( Wrap32::wrap( b, zero_point ) - Wrap32::wrap( a, zero_point ),
+                      distance );
     }
 
   } catch ( const exception& e ) {
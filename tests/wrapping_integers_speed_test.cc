@@ -0,0 +1,83 @@
+#include "wrapping_integers.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Unwrapping a list of sequence numbers near the checkpoint (like the ACK and SACK edges a sender
+// sees), one at a time with unwrap and all at once with unwrap_many.
+void program_body()
+{
+  constexpr size_t list_length = 64;
+  constexpr size_t rounds = 200000;
+
+  default_random_engine rd { 1374 };
+  const Wrap32 zero_point { uniform_int_distribution<uint32_t> {}( rd ) };
+  const uint64_t checkpoint = uniform_int_distribution<uint64_t> { 0, uint64_t { 1 } << 40 }( rd );
+  vector<Wrap32> seqnos;
+  for ( size_t i = 0; i < list_length; i++ ) {
+    const uint64_t n = checkpoint + uniform_int_distribution<uint64_t> { 0, 1 << 20 }( rd ) - ( 1 << 19 );
+    seqnos.push_back( Wrap32::wrap( n, zero_point ) );
+  }
+
+  vector<uint64_t> one_by_one( list_length );
+  vector<uint64_t> batch( list_length );
+  uint64_t sum_one_by_one = 0;
+  uint64_t sum_batch = 0;
+
+  const auto start_one_by_one = steady_clock::now();
+  for ( size_t round = 0; round < rounds; round++ ) {
+    for ( size_t i = 0; i < list_length; i++ ) {
+      one_by_one[i] = seqnos[i].unwrap( zero_point, checkpoint + round );
+    }
+    sum_one_by_one += one_by_one[round % list_length];
+  }
+  const auto start_batch = steady_clock::now();
+  for ( size_t round = 0; round < rounds; round++ ) {
+    Wrap32::unwrap_many( seqnos, zero_point, checkpoint + round, batch );
+    sum_batch += batch[round % list_length];
+  }
+  const auto stop = steady_clock::now();
+
+  if ( sum_one_by_one != sum_batch or one_by_one != batch ) {
+    throw runtime_error( "unwrap_many disagrees with unwrap" );
+  }
+
+  const double values = static_cast<double>( rounds * list_length );
+  const double ns_one_by_one = duration<double, nano>( start_batch - start_one_by_one ).count() / values;
+  const double ns_batch = duration<double, nano>( stop - start_batch ).count() / values;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Wrap32 unwrap: " << fixed << setprecision( 3 ) << ns_one_by_one << " ns per value one by one, "
+       << ns_batch << " ns per value with unwrap_many.\n";
+
+  debug_output << "             Wrap32 unwrap: " << fixed << setprecision( 3 ) << ns_one_by_one << " ns/value, "
+               << ns_batch << " ns/value batched\n";
+
+  if ( ns_one_by_one > 50 or ns_batch > 50 ) {
+    throw runtime_error( "Wrap32 unwrap did not meet the maximum of 50 ns per value." );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
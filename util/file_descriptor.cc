@@ -3,6 +3,7 @@
 #include "exception.hh"
 
 #include <algorithm>
+#include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -86,11 +87,20 @@ void FileDescriptor::read( string& buffer )
     buffer.resize( kReadBufferSize );
   }
 
+  buffer.resize( read( span<char> { buffer } ) );
+}
+
+// buffer is caller-owned memory to be read into (e.g. space reserved in a ByteStream)
+size_t FileDescriptor::read( span<char> buffer )
+{
+  if ( buffer.empty() ) {
+    throw runtime_error( "read() into an empty buffer would look like EOF" );
+  }
+
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      buffer.clear();
-      return;
+      return 0;
     }
     throw unix_error { "read" };
   }
@@ -105,7 +115,7 @@ void FileDescriptor::read( string& buffer )
     throw runtime_error( "read() read more than requested" );
   }
 
-  buffer.resize( bytes_read );
+  return bytes_read;
 }
 
 void FileDescriptor::read( vector<string>& buffers )
@@ -176,8 +186,9 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
     total_size += x.size();
   }
 
-  const ssize_t bytes_written
-    = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
+  // writev() refuses more than IOV_MAX buffers, so write the first IOV_MAX and report a short write
+  const int iovcnt = static_cast<int>( min( iovecs.size(), static_cast<size_t>( IOV_MAX ) ) );
+  const ssize_t bytes_written = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), iovcnt ) );
   register_write();
 
   if ( bytes_written == 0 and total_size != 0 ) {
@@ -3,6 +3,8 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -64,6 +66,8 @@ public:
   // Read into `buffer`
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
+  // returns number of bytes read (0 at EOF, or if a non-blocking fd has nothing to read)
+  size_t read( std::span<char> buffer );
 
   // Attempt to write a buffer
   // returns number of bytes written
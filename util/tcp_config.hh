@@ -1,6 +1,7 @@
 #pragma once
 
 #include "address.hh"
+#include "congestion_control.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
@@ -11,15 +12,30 @@
 class TCPConfig
 {
 public:
-  static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
-  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
-  static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
-  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t DEFAULT_CAPACITY = 64000;  //!< Default capacity
+  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet
+  static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
+  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t MAPPED_CAPACITY = 1 << 26; //!< Streams at least this large live in a mapped file
+  static constexpr size_t MAX_SACK_BLOCKS = 4;       //!< Most SACK blocks that fit in the TCP options
+  static constexpr unsigned DUP_THRESH = 3;          //!< Segments SACKed after a missing one before it's lost
+  static constexpr unsigned MAX_PROBES = 3;          //!< Losses of an MTU probe before its size is given up on
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14;    //!< Largest window scale (RFC 7323): windows up to 1 GB
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
+  uint64_t reassembly_limit = UINT64_MAX;  //!< Most out-of-order bytes the receiver keeps, in bytes
+  bool reassemble_in_place = false;        //!< Receive into a ring, writing out-of-order bytes where they go
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+  bool adaptive_rto = false;               //!< Let the RTO follow the measured RTTs (RFC 6298), from rt_timeout
+  uint64_t rto_min_ms = 10;                //!< Lowest adaptive RTO, in milliseconds
+  uint64_t rto_max_ms = 60000;             //!< Highest adaptive RTO (after backoff too), in milliseconds
+  bool pacing = false;                     //!< Spread the sender's messages out over each RTT
+  size_t mss = MAX_PAYLOAD_SIZE;           //!< Largest payload sent, and taken (sent in the MSS option)
+  bool mtu_probing = false;                //!< Start at MAX_PAYLOAD_SIZE, then probe up to `mss` (RFC 4821)
+  bool window_scaling = false;             //!< Scale windows (RFC 7323) so all of recv_capacity can be offered
+  CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::None; //!< Sender's algorithm
 };
 
 //! Config for classes derived from FdAdapter
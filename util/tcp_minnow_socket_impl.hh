@@ -66,6 +66,13 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
 
+  // once the outbound stream fills up, only read from the application again when half of it has drained,
+  // so that the sender isn't woken up for every byte of window that opens, and reads stay large.
+  // (a stream of fewer than two bytes has no room between the watermarks, so it keeps the defaults.)
+  if ( config.send_capacity >= 2 ) {
+    _tcp->outbound_writer().set_watermarks( config.send_capacity / 2, config.send_capacity );
+  }
+
   // Set up the event loop
 
   // There are three events to handle:
@@ -105,10 +112,9 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      // read straight into the outbound stream's storage.
+      Writer& outbound = _tcp->outbound_writer();
+      outbound.commit( _thread_data.read( outbound.reserve( outbound.available_capacity() ) ) );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -124,8 +130,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
     },
     [&] {
-      return ( _tcp->active() ) and ( not _outbound_shutdown )
-             and ( _tcp->outbound_writer().available_capacity() > 0 );
+      return ( _tcp->active() ) and ( not _outbound_shutdown ) and ( _tcp->outbound_writer().is_writable() );
     },
     [&] {
       _tcp->outbound_writer().close();
@@ -143,12 +148,11 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     Direction::Out,
     [&] {
       Reader& inbound = _tcp->inbound_reader();
-      // Write from the inbound_stream into
-      // the pipe, handling the possibility of a partial
+      // Write everything buffered in the inbound_stream into
+      // the pipe with one writev, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        const auto bytes_written = _thread_data.write( inbound.peek_regions() );
         inbound.pop( bytes_written );
       }
 
@@ -7,6 +7,7 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
 #include <functional>
 #include <optional>
 
@@ -72,6 +73,15 @@ public:
     // Give incoming TCPSenderMessage to receiver.
     receiver_.receive( std::move( msg.sender ) );
 
+    // SACK blocks only go to a peer that said, on its SYN, that it takes them (RFC 2018).
+    peer_SACK_permitted_ |= msg.receiver.SACK_permitted;
+
+    // A window scale option (on the peer's SYN) means the peer scales windows too.
+    if ( msg.receiver.window_scale.has_value() ) {
+      peer_window_scale_ = std::min( msg.receiver.window_scale.value(), TCPConfig::MAX_WINDOW_SCALE );
+      negotiate_window_scale();
+    }
+
     // Give incoming TCPReceiverMessage to sender.
     sender_.receive( msg.receiver );
 
@@ -87,17 +97,92 @@ public:
   const TCPSender& sender() const { return sender_; }
 
 private:
+  // Very large streams are kept in a mapped file rather than on the heap.
+  static ByteStream make_stream( uint64_t capacity, ByteStream::Storage storage )
+  {
+    return ByteStream { capacity, capacity >= TCPConfig::MAPPED_CAPACITY ? ByteStream::Storage::Mapped : storage };
+  }
+
+  // By default, the payloads received are kept as they are, and handed to the stream without a copy once
+  // in order. In place, every byte is copied once, into the ring, but no string is kept per segment.
+  static Reassembler make_reassembler( const TCPConfig& cfg )
+  {
+    const auto storage = cfg.reassemble_in_place ? ByteStream::Storage::Ring : ByteStream::Storage::Chunked;
+    Reassembler reassembler { make_stream( cfg.recv_capacity, storage ) };
+    reassembler.set_memory_limit( cfg.reassembly_limit );
+    return reassembler;
+  }
+
+  static TCPSender make_sender( const TCPConfig& cfg )
+  {
+    TCPSender sender { make_stream( cfg.send_capacity, ByteStream::Storage::Ring ),
+                       cfg.isn,
+                       cfg.rt_timeout,
+                       cfg.congestion_control };
+    if ( cfg.adaptive_rto ) {
+      sender.set_adaptive_RTO( cfg.rto_min_ms, cfg.rto_max_ms );
+    }
+    sender.set_pacing( cfg.pacing );
+    if ( cfg.mtu_probing ) {
+      sender.set_path_MTU_discovery( cfg.mss );
+    } else {
+      sender.set_MSS( cfg.mss );
+    }
+    return sender;
+  }
+
+  // The smallest window scale that lets the receiver offer all of its capacity.
+  static uint8_t window_scale( uint64_t capacity )
+  {
+    uint8_t scale = 0;
+    while ( scale < TCPConfig::MAX_WINDOW_SCALE and capacity >> scale > UINT16_MAX ) {
+      scale++;
+    }
+    return scale;
+  }
+
+  // Windows are scaled (RFC 7323) once both ends have sent the window scale option on their SYNs, from the
+  // first message after them.
+  void negotiate_window_scale()
+  {
+    if ( cfg_.window_scaling and sent_SYN_ and peer_window_scale_.has_value() ) {
+      receiver_.set_window_scale( window_scale( cfg_.recv_capacity ) );
+      sender_.set_window_scale( peer_window_scale_.value() );
+    }
+  }
+
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  TCPSender sender_ { make_sender( cfg_ ) };
+  TCPReceiver receiver_ { make_reassembler( cfg_ ) };
 
   bool need_send_ {};
+  bool sent_SYN_ {};
+  bool peer_SACK_permitted_ {};
+  std::optional<uint8_t> peer_window_scale_ {};
 
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
     TCPMessage msg { sender_message, receiver_.send() };
+    if ( not peer_SACK_permitted_ ) {
+      msg.receiver.sack.clear();
+    }
+    if ( sender_message.SYN ) {
+      // (the window on a SYN is never scaled, RFC 7323, even on one sent again after scaling started.)
+      msg.receiver.window_size
+        = static_cast<uint16_t>( std::min<uint64_t>( receiver_.writer().available_capacity(), UINT16_MAX ) );
+      msg.receiver.SACK_permitted = true;
+      msg.receiver.MSS = static_cast<uint16_t>( std::min<size_t>( cfg_.mss, UINT16_MAX ) );
+      if ( cfg_.window_scaling ) {
+        msg.receiver.window_scale = window_scale( cfg_.recv_capacity );
+      }
+    }
     transmit( std::move( msg ) );
     need_send_ = false;
+
+    if ( sender_message.SYN and not sent_SYN_ ) {
+      sent_SYN_ = true;
+      negotiate_window_scale();
+    }
   }
 
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
@@ -3,20 +3,33 @@
 #include "wrapping_integers.hh"
 
 #include <optional>
+#include <utility>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains three fields:
+ * It contains six fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header), unless the window is scaled (see 6).
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) The SACK blocks (RFC 2018). Each one is a [left, right) range of sequence numbers, past the ackno, that
+ *    the TCP receiver already holds, the most recently received first. The sender doesn't need to send those
+ *    again. At most TCPConfig::MAX_SACK_BLOCKS of them fit in a segment (fewer on a SYN, with its options).
+ *    SACK_permitted, on a SYN, says that this end takes SACK blocks; they're only sent to an end that said so.
+ *
+ * 5) The MSS (RFC 9293): the largest payload the TCP receiver takes in one segment. It's only sent on a SYN (in
+ *    the MSS option), and a sender that never got one keeps to TCPConfig::MAX_PAYLOAD_SIZE.
+ *
+ * 6) The window scale (RFC 7323). Also only sent on a SYN: if both ends send one, the windows after their SYNs
+ *    are in units of 2^(the window scale the receiver sent) sequence numbers, so they can be larger than 64 kB.
  */
 
 struct TCPReceiverMessage
@@ -24,4 +37,8 @@ struct TCPReceiverMessage
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+  std::vector<std::pair<Wrap32, Wrap32>> sack {};
+  bool SACK_permitted {};
+  std::optional<uint16_t> MSS {};
+  std::optional<uint8_t> window_scale {};
 };
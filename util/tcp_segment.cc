@@ -1,13 +1,143 @@
 #include "tcp_segment.hh"
 #include "checksum.hh"
+#include "tcp_config.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
+static constexpr size_t MaxOptionsLength = 40;  // bytes (the data offset is at most 15 words)
+
+// Kinds of TCP options
+static constexpr uint8_t OptionEnd = 0;
+static constexpr uint8_t OptionNOP = 1;
+static constexpr uint8_t OptionMSS = 2;           // RFC 9293
+static constexpr uint8_t OptionWindowScale = 3;   // RFC 7323
+static constexpr uint8_t OptionSACKPermitted = 4; // RFC 2018
+static constexpr uint8_t OptionSACK = 5;          // RFC 2018
 
 using namespace std;
 
+namespace {
+
+class Wrap32Serializable : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return _raw_value; }
+};
+
+// The length of the options that only go on a SYN: the MSS, the window scale and SACK permitted.
+size_t syn_options_length( const TCPMessage& message )
+{
+  if ( not message.sender.SYN ) {
+    return 0;
+  }
+  return ( message.receiver.MSS.has_value() ? 4 : 0 )          // MSS
+         + ( message.receiver.window_scale.has_value() ? 4 : 0 ) // NOP, window scale
+         + ( message.receiver.SACK_permitted ? 4 : 0 );          // NOP, NOP, SACK permitted
+}
+
+// How many of the SACK blocks go in the header (the others don't fit in the options, after the SYN's).
+size_t sack_blocks( const TCPMessage& message )
+{
+  const size_t room = MaxOptionsLength - syn_options_length( message );
+  const size_t fit = room >= 4 ? ( room - 4 ) / 8 : 0; // NOP, NOP, SACK, then 8 bytes a block
+  return min( { message.receiver.sack.size(), TCPConfig::MAX_SACK_BLOCKS, fit } );
+}
+
+// Read the `length` bytes of options that follow the fixed part of the header. Options this TCP
+// doesn't know are skipped (as are the SYN's options, on other segments); an option that runs past the
+// header is an error.
+void parse_options( Parser& parser, size_t length, TCPMessage& message )
+{
+  while ( length > 0 and not parser.has_error() ) {
+    uint8_t kind {};
+    parser.integer( kind );
+    length--;
+    if ( kind == OptionEnd ) {
+      break;
+    }
+    if ( kind == OptionNOP ) {
+      continue;
+    }
+
+    uint8_t option_length {};
+    parser.integer( option_length );
+    if ( length == 0 or option_length < 2 or option_length - 1U > length ) {
+      parser.set_error();
+      return;
+    }
+    const size_t body = option_length - 2;
+    length -= option_length - 1;
+
+    if ( kind == OptionMSS and body == 2 ) {
+      uint16_t mss {};
+      parser.integer( mss );
+      if ( message.sender.SYN ) {
+        message.receiver.MSS = mss;
+      }
+    } else if ( kind == OptionWindowScale and body == 1 ) {
+      uint8_t shift {};
+      parser.integer( shift );
+      if ( message.sender.SYN ) {
+        message.receiver.window_scale = shift;
+      }
+    } else if ( kind == OptionSACKPermitted and body == 0 ) {
+      message.receiver.SACK_permitted = message.sender.SYN;
+    } else if ( kind == OptionSACK and body % 8 == 0 ) {
+      for ( size_t i = 0; i < body / 8; i++ ) {
+        uint32_t left {};
+        uint32_t right {};
+        parser.integer( left );
+        parser.integer( right );
+        message.receiver.sack.emplace_back( Wrap32 { left }, Wrap32 { right } );
+      }
+    } else {
+      parser.remove_prefix( body );
+    }
+  }
+
+  // padding after the end of the options
+  parser.remove_prefix( length );
+}
+
+// The options that header_length() counts: the MSS, the window scale and SACK permitted on a SYN, then the
+// SACK blocks.
+void serialize_options( Serializer& serializer, const TCPMessage& message )
+{
+  if ( message.sender.SYN and message.receiver.MSS.has_value() ) {
+    serializer.integer( OptionMSS );
+    serializer.integer( uint8_t { 4 } );
+    serializer.integer( message.receiver.MSS.value() );
+  }
+  if ( message.sender.SYN and message.receiver.window_scale.has_value() ) {
+    serializer.integer( OptionNOP );
+    serializer.integer( OptionWindowScale );
+    serializer.integer( uint8_t { 3 } );
+    serializer.integer( message.receiver.window_scale.value() );
+  }
+  if ( message.sender.SYN and message.receiver.SACK_permitted ) {
+    serializer.integer( OptionNOP );
+    serializer.integer( OptionNOP );
+    serializer.integer( OptionSACKPermitted );
+    serializer.integer( uint8_t { 2 } );
+  }
+
+  if ( const size_t blocks = sack_blocks( message ) ) {
+    serializer.integer( OptionNOP );
+    serializer.integer( OptionNOP );
+    serializer.integer( OptionSACK );
+    serializer.integer( static_cast<uint8_t>( 2 + 8 * blocks ) );
+    for ( size_t i = 0; i < blocks; i++ ) {
+      serializer.integer( Wrap32Serializable { message.receiver.sack[i].first }.raw_value() );
+      serializer.integer( Wrap32Serializable { message.receiver.sack[i].second }.raw_value() );
+    }
+  }
+}
+
+} // namespace
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -47,28 +177,26 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  message.receiver.sack.clear();
+  message.receiver.MSS.reset();
+  message.receiver.window_scale.reset();
+  message.receiver.SACK_permitted = false;
+  parse_options( parser, data_offset * 4 - TCPHeaderMinLen * 4, message );
 
   parser.all_remaining( message.sender.payload );
 }
 
-class Wrap32Serializable : public Wrap32
-{
-public:
-  uint32_t raw_value() const { return _raw_value; }
-};
-
 void TCPSegment::serialize( Serializer& serializer ) const
 {
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
+  serializer.integer( static_cast<uint8_t>( header_length() / 4 << 4 ) ); // data offset
   const bool reset = message.sender.RST or message.receiver.RST;
   const uint8_t flags = ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
@@ -76,6 +204,7 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver.window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+  serialize_options( serializer, message );
   serializer.buffer( message.sender.payload );
 }
 
@@ -89,3 +218,12 @@ void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
   check.add( s.output() );
   udinfo.cksum = check.value();
 }
+
+size_t TCPSegment::header_length() const
+{
+  size_t options = syn_options_length( message );
+  if ( const size_t blocks = sack_blocks( message ) ) {
+    options += 4 + 8 * blocks; // NOP, NOP, SACK
+  }
+  return TCPHeaderMinLen * 4 + options;
+}